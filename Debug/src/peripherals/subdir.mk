@@ -5,39 +5,54 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
 ../src/peripherals/AnalogIn.c \
+../src/peripherals/BusIn.c \
+../src/peripherals/BusOut.c \
 ../src/peripherals/Digital.c \
 ../src/peripherals/DigitalIn.c \
 ../src/peripherals/DigitalOut.c \
 ../src/peripherals/HardwareTimer.c \
 ../src/peripherals/I2C.c \
 ../src/peripherals/InterruptIn.c \
+../src/peripherals/PortCapture.c \
+../src/peripherals/PulseCounter.c \
 ../src/peripherals/PWM.c \
 ../src/peripherals/Serial.c \
-../src/peripherals/SoftwareTimer.c 
+../src/peripherals/SoftwareTimer.c \
+../src/peripherals/Timebase.c 
 
 OBJS += \
 ./src/peripherals/AnalogIn.o \
+./src/peripherals/BusIn.o \
+./src/peripherals/BusOut.o \
 ./src/peripherals/Digital.o \
 ./src/peripherals/DigitalIn.o \
 ./src/peripherals/DigitalOut.o \
 ./src/peripherals/HardwareTimer.o \
 ./src/peripherals/I2C.o \
 ./src/peripherals/InterruptIn.o \
+./src/peripherals/PortCapture.o \
+./src/peripherals/PulseCounter.o \
 ./src/peripherals/PWM.o \
 ./src/peripherals/Serial.o \
-./src/peripherals/SoftwareTimer.o 
+./src/peripherals/SoftwareTimer.o \
+./src/peripherals/Timebase.o 
 
 C_DEPS += \
 ./src/peripherals/AnalogIn.d \
+./src/peripherals/BusIn.d \
+./src/peripherals/BusOut.d \
 ./src/peripherals/Digital.d \
 ./src/peripherals/DigitalIn.d \
 ./src/peripherals/DigitalOut.d \
 ./src/peripherals/HardwareTimer.d \
 ./src/peripherals/I2C.d \
 ./src/peripherals/InterruptIn.d \
+./src/peripherals/PortCapture.d \
+./src/peripherals/PulseCounter.d \
 ./src/peripherals/PWM.d \
 ./src/peripherals/Serial.d \
-./src/peripherals/SoftwareTimer.d 
+./src/peripherals/SoftwareTimer.d \
+./src/peripherals/Timebase.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
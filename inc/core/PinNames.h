@@ -26,20 +26,42 @@
 
 #define GET_PORT_NUM(pin)	(pin >> 5)
 #define GET_MASK_NUM(pin)	(0x1 << (pin & 0x1F))
-#define SET_BIT(reg,bitNum)	(reg |= (0x1 << bitNum))
-#define CLEAR_BIT(reg,bitNum)	(reg &= ~(0x1 << bitNum))
+#define SET_BIT(reg,bitNum)	((reg) |= (0x1 << (bitNum)))
+#define CLEAR_BIT(reg,bitNum)	((reg) &= ~(0x1 << (bitNum)))
+
+/*
+ * Single bit access without read-modify-write.
+ * On Cortex-M3 (LPC13XX and LPC17XX) each bit of the peripheral (0x400xxxxx) and SRAM (0x200xxxxx) regions
+ * has a word in the bit-band alias region, so the bit is changed by one store that is atomic against interrupts.
+ * The register must be inside one of these regions (the LPC13XX GPIO at 0x5000xxxx is not, use MASKED_ACCESS)
+ * and must not have write-one-to-clear bits (IR, IC, ...), because the hardware writes the whole word back.
+ * On Cortex-M0 (LPC111X) there is no bit-band and these fall back to SET_BIT/CLEAR_BIT.
+ */
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC17XX)
+#define BITBAND_ADDR(reg,bitNum)		((volatile uint32_t*) ((((uint32_t) &(reg)) & 0xF0000000) + 0x02000000 + \
+											((((uint32_t) &(reg)) & 0x000FFFFF) << 5) + ((bitNum) << 2)))
+#define BITBAND_SET_BIT(reg,bitNum)		(*BITBAND_ADDR(reg,bitNum) = 1)
+#define BITBAND_CLEAR_BIT(reg,bitNum)	(*BITBAND_ADDR(reg,bitNum) = 0)
+#define BITBAND_READ_BIT(reg,bitNum)	(*BITBAND_ADDR(reg,bitNum))
+#else
+#define BITBAND_SET_BIT(reg,bitNum)		SET_BIT(reg,bitNum)
+#define BITBAND_CLEAR_BIT(reg,bitNum)	CLEAR_BIT(reg,bitNum)
+#define BITBAND_READ_BIT(reg,bitNum)	(((reg) >> (bitNum)) & 0x1)
+#endif
 
 #if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
-#define GET_PIN_INDEX(pin)	(((pin / 0x20) * 12) + (pin % 12))
+#define GET_PIN_INDEX(pin)	((((pin) >> 5) * 12) + ((pin) & 0x1F))
+#define IS_VALID_PIN(pin)	((((uint32_t)(pin) >> 5) < 4) && (((pin) & 0x1F) < 12) && (GET_PIN_INDEX(pin) < NUMBER_IO_PINS))
 #elif defined (TARGET_LPC17XX)
-#error need definition of GET_PIN_INDEX(pin)
+#define GET_PIN_INDEX(pin)	(pin)
+#define IS_VALID_PIN(pin)	((uint32_t)(pin) < NUMBER_IO_PINS)
 #endif
 
 
 #if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
 #define NUMBER_IO_PINS	(3 * 12 + 4)
 #elif defined (TARGET_LPC17XX)
-#define NUMBER_IO_PINS amount_of_pins_in_lpc17xx
+#define NUMBER_IO_PINS	(5 * 32)
 #else
 #error You must define the target architeture: TARGET_LPC111X, TARGET_LPC13XX or TARGET_LPC17XX
 #endif
@@ -106,6 +128,16 @@ typedef enum {
 	, USBTX = P0_2
 	, USBRX = P0_3
 
+	// Analog inputs (AD0.0 to AD0.7)
+	, AD0 = P0_23
+	, AD1 = P0_24
+	, AD2 = P0_25
+	, AD3 = P0_26
+	, AD4 = P1_30
+	, AD5 = P1_31
+	, AD6 = P0_3
+	, AD7 = P0_2
+
 	// Not connected
 	, NC = (int)0xFFFFFFFF
 
@@ -37,5 +37,22 @@ typedef enum {
 
 typedef void (*FunctionPointer)(void);
 
+/* Callback receiving the user context, the event source (pin, channel, timer or port) and an event value */
+typedef void (*ContextFunctionPointer)(void* context, uint32_t source, uint32_t value);
+
+typedef struct {
+	ContextFunctionPointer function;
+	void* context;
+} ContextHandler;
+
+static inline void ContextHandler_call(const ContextHandler* handler, uint32_t source, uint32_t value){
+	if(handler->function != NULL){
+		handler->function(handler->context, source, value);
+	}
+}
+
+/* Compile time check, msg must be a valid identifier. Usable at file scope and inside functions. */
+#define STATIC_ASSERT(cond, msg)	typedef char STATIC_ASSERT_##msg[(cond) ? 1 : -1]
+
 
 #endif
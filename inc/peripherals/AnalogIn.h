@@ -12,6 +12,7 @@
 
 #include "core/PinNames.h"
 #include "core/Types.h"
+#include "peripherals/HardwareTimer.h"
 
 #define AnalogIn_STAT_DONE_MASK		0x000000FF
 #define AnalogIn_STAT_OVERRUN_MASK	0x0000FF00
@@ -25,9 +26,46 @@
 #define AnalogIn_CHANNEL_OVERRUN_MASK	0x40000000
 #define AnalogIn_CHANNEL_ADINT_MASK		0x00010000
 
+#define AnalogIn_MAX_OVERSAMPLING_BITS	4			/* 4^4 = 256 conversions accumulated per output */
+#define AnalogIn_INVALID_CHANNEL		0xFF		/* AnalogIn_getChannelNum result for pins without AD function */
+
+/* Build time pin validation, e.g. AnalogIn_CHECK_PIN(P1_4, sensor_pin_must_be_analog); */
+#define AnalogIn_IS_ANALOG_PIN(pin)		((pin) == AD0 || (pin) == AD1 || (pin) == AD2 || (pin) == AD3 || \
+										 (pin) == AD4 || (pin) == AD5 || (pin) == AD6 || (pin) == AD7)
+#define AnalogIn_CHECK_PIN(pin, msg)	STATIC_ASSERT(AnalogIn_IS_ANALOG_PIN(pin), msg)
+
+#define AnalogIn_Q16_ONE				0x00010000	/* 1.0 in Q16 fixed point */
+#define AnalogIn_Q16(x)					((int32_t)((x) * 65536.0 + (((x) < 0) ? -0.5 : 0.5)))	/* Constant to Q16, folded at compile time */
+#define AnalogIn_INVALID_UNITS			((int32_t)0x80000000)	/* AnalogIn_readUnits result on overrun */
+
+#if defined (TARGET_LPC17XX)
+#define AnalogIn_DMA_CHANNEL			0			/* GPDMA channel used by the ADC */
+#define AnalogIn_DMA_REQUEST			4			/* GPDMA peripheral request line of the ADC */
+#define AnalogIn_DMA_MAX_BLOCK_SIZE		0xFFF		/* GPDMA TransferSize field has 12 bits */
+#define AnalogIn_DMA_GET_CHANNEL(word)	(((word) >> 24) & 0x07)	/* Channel of a word stored by DMA (ADGDR format) */
+#define AnalogIn_DMA_GET_VALUE(word)	(((word) >> 4) & 0xFFF)		/* Result of a word stored by DMA (ADGDR format) */
+#endif
+
+typedef enum {
+	ANALOG_FILTER_BOXCAR,	/* Accumulate and dump: plain average of 4^n conversions */
+	ANALOG_FILTER_CIC		/* Second order CIC decimator (sinc^2 response) */
+}AnalogInFilter;
+
+typedef enum {
+	ANALOG_ZONE_NORMAL,		/* Between the low and high thresholds */
+	ANALOG_ZONE_LOW,		/* Below the low threshold */
+	ANALOG_ZONE_HIGH		/* Above the high threshold */
+}AnalogInZone;
+
+typedef struct {
+	uint32_t timestamp;		/* Timer counter value when the conversion was collected */
+	uint32_t value;			/* Conversion result (decimated if oversampling is enabled) */
+}AnalogInSample;
+
 
 void AnalogIn_Init(PinName pin, bool useIRQ);
 int32_t AnalogIn_read(PinName pin);
+void AnalogIn_readMany(const PinName* pins, uint8_t count, int32_t* values);
 void AnalogIn_default_handler ();
 
 void AnalogIn_startConversion();
@@ -41,6 +79,30 @@ void AnalogIn_storeInterrupFlags();
 void AnalogIn_clearInterrupFlags();
 void AnalogIn_setClock(uint32_t clock);
 void AnalogIn_setUserHandler(PinName pin, FunctionPointer usrHandler);
+void AnalogIn_setContextHandler(PinName pin, ContextFunctionPointer usrHandler, void* context);
+void AnalogIn_setOversampling(PinName pin, uint8_t extraBits, AnalogInFilter filter);
+
+void AnalogIn_setWindow(PinName pin, uint32_t lowThreshold, uint32_t highThreshold, uint32_t hysteresis);
+void AnalogIn_disableWindow(PinName pin);
+AnalogInZone AnalogIn_getZone(PinName pin);
+
+void AnalogIn_setCalibration(PinName pin, int32_t offset, int32_t gain);
+bool AnalogIn_setCalibrationTable(PinName pin, const int32_t* table, uint8_t tableSize, uint8_t stepBits);
+int32_t AnalogIn_toUnits(PinName pin, int32_t raw);
+int32_t AnalogIn_readUnits(PinName pin);
+
+void AnalogIn_setSampleBuffer(PinName pin, AnalogInSample* allocatedBuffer, uint16_t bufferSize);
+uint16_t AnalogIn_readSamples(PinName pin, AnalogInSample* samples, uint16_t maxSamples);
+uint16_t AnalogIn_availableSamples(PinName pin);
+uint32_t AnalogIn_getOverrunCount(PinName pin);
+void AnalogIn_setTimestampTimer(HardwareTimerNum timerNum);
+
+#if defined (TARGET_LPC17XX)
+void AnalogIn_startDMA(const PinName* pins, uint8_t count, uint32_t* allocatedBuffer, uint16_t blockSize, FunctionPointer blockHandler);
+void AnalogIn_stopDMA();
+uint32_t* AnalogIn_getDMABlock();
+void AnalogIn_DMA_default_handler();
+#endif
 
 #endif
 
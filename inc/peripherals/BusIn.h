@@ -0,0 +1,32 @@
+/**************************************************************************//**
+ *
+ * @file     BusIn.h
+ * @author	 David Alain <dnascimento@fitec.org.br>
+ * @brief    File with functions to read a parallel bus of digital inputs.
+ * @version  V1.0
+ *
+ ******************************************************************************/
+
+#ifndef _BUSIN_H_
+#define _BUSIN_H_
+
+#include "core/PinNames.h"
+#include "core/Types.h"
+
+#define BusIn_MAX_PINS		16		/* Bus width limit, all pins must be on the same port */
+
+typedef struct {
+	uint8_t portNum;
+	uint8_t width;
+	uint8_t shift;				/* Position of bit 0 when the pins are contiguous and in order */
+	bool contiguous;
+	uint32_t mask;				/* Port bits used by the bus */
+	uint8_t nibbleCount;		/* Port nibbles that hold at least one pin of the bus */
+	uint8_t nibbleShift[8];
+	uint16_t gather[8][16];	/* Value bits of each port nibble */
+} BusInObj;
+
+bool BusIn_Init(BusInObj* bus, const PinName* pins, uint8_t count);
+uint32_t BusIn_read(BusInObj* bus);
+
+#endif
@@ -0,0 +1,31 @@
+/**************************************************************************//**
+ *
+ * @file     BusOut.h
+ * @author	 David Alain <dnascimento@fitec.org.br>
+ * @brief    File with functions to control a parallel bus of digital outputs.
+ * @version  V1.0
+ *
+ ******************************************************************************/
+
+#ifndef _BUSOUT_H_
+#define _BUSOUT_H_
+
+#include "core/PinNames.h"
+#include "core/Types.h"
+
+#define BusOut_MAX_PINS		16		/* Bus width limit, all pins must be on the same port */
+
+typedef struct {
+	uint8_t portNum;
+	uint8_t width;
+	uint8_t shift;				/* Position of bit 0 when the pins are contiguous and in order */
+	bool contiguous;
+	uint32_t mask;				/* Port bits used by the bus */
+	uint32_t scatter[BusOut_MAX_PINS / 4][16];	/* Port bits of each nibble of the value */
+} BusOutObj;
+
+bool BusOut_Init(BusOutObj* bus, const PinName* pins, uint8_t count);
+void BusOut_write(BusOutObj* bus, uint32_t value);
+uint32_t BusOut_read(BusOutObj* bus);
+
+#endif
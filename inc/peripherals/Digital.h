@@ -11,11 +11,48 @@
 #define _DIGITAL_H_
 
 #include "core/PinNames.h"
+#include "core/Types.h"
+
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+#define Digital_PORTS			4
+#elif defined (TARGET_LPC17XX)
+#define Digital_PORTS			5
+#endif
+
+#define Digital_TABLE_SIZE(table)	(sizeof(table) / sizeof((table)[0]))
+
+typedef enum {
+	PIN_INPUT,
+	PIN_OUTPUT,
+	PIN_ANALOG		/* Input with the digital receiver and the pulls disabled */
+} PinDirection;
+
+typedef enum {
+	PIN_MODE_NO_PULL,
+	PIN_MODE_PULL_UP,
+	PIN_MODE_PULL_DOWN,
+	PIN_MODE_REPEATER
+} PinMode;
+
+typedef struct {
+	PinName pin;
+	uint8_t function;		/* IOCON FUNC (LPC13xx/LPC111X) or PINSEL value (LPC17xx) of the pin, see the user manual */
+	PinMode mode;
+	PinDirection direction;
+	uint8_t level;			/* Initial level of outputs */
+} PinConfig;
 
 void Digital_disablePull(PinName pin);
 void Digital_enablePullUp(PinName pin);
 void Digital_enablePullDown(PinName pin);
 void Digital_enableRepeater(PinName pin);
+void Digital_enableOpenDrain(PinName pin);
+void Digital_disableOpenDrain(PinName pin);
+
+void Digital_writePort(uint8_t portNum, uint32_t mask, uint32_t value);
+uint32_t Digital_readPort(uint8_t portNum, uint32_t mask);
+
+void Digital_configurePins(const PinConfig* table, uint16_t count);
 
 #endif
 
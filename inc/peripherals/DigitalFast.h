@@ -0,0 +1,111 @@
+/**************************************************************************//**
+ *
+ * @file     DigitalFast.h
+ * @author	 David Alain <dnascimento@fitec.org.br>
+ * @brief    Inline digital input/output for pins known at compile time.
+ * @version  V1.0
+ *
+ * When pin is a constant the port address and the mask are computed by the compiler,
+ * so each write is one store and each read is one load (no LPC_GPIO[] lookup, no read-modify-write).
+ * The pin must be initialized first with DigitalOut_Init or DigitalIn_Init.
+ *
+ * Example: bit-banged clock
+ *     DigitalFast_high(P0_7);
+ *     DigitalFast_low(P0_7);
+ *
+ ******************************************************************************/
+
+#ifndef _DIGITAL_FAST_H_
+#define _DIGITAL_FAST_H_
+
+#include "core/PinNames.h"
+
+#if defined (__GNUC__)
+#define DigitalFast_INLINE	static __INLINE __attribute__((always_inline))	/* Inlined even at -O0 */
+#else
+#define DigitalFast_INLINE	static __INLINE
+#endif
+
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+#define DigitalFast_PORT(pin)	((LPC_GPIO_TypeDef*) (LPC_GPIO_BASE + (GET_PORT_NUM(pin) * 0x10000)))
+#elif defined (TARGET_LPC17XX)
+#define DigitalFast_PORT(pin)	((LPC_GPIO_TypeDef*) (LPC_GPIO_BASE + (GET_PORT_NUM(pin) * 0x20)))
+#endif
+
+/**
+ * Writes high level on pin.
+ *
+ * @param pin
+ */
+DigitalFast_INLINE void DigitalFast_high(PinName pin){
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+	DigitalFast_PORT(pin)->MASKED_ACCESS[GET_MASK_NUM(pin)] = GET_MASK_NUM(pin);
+#elif defined (TARGET_LPC17XX)
+	DigitalFast_PORT(pin)->FIOSET = GET_MASK_NUM(pin);
+#endif
+}
+
+/**
+ * Writes low level on pin.
+ *
+ * @param pin
+ */
+DigitalFast_INLINE void DigitalFast_low(PinName pin){
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+	DigitalFast_PORT(pin)->MASKED_ACCESS[GET_MASK_NUM(pin)] = 0;
+#elif defined (TARGET_LPC17XX)
+	DigitalFast_PORT(pin)->FIOCLR = GET_MASK_NUM(pin);
+#endif
+}
+
+/**
+ * Writes a digital value on pin, low level if value is zero, otherwise high level.
+ * On LPC13xx/LPC111X it is a single store, even when value is not constant.
+ *
+ * @param pin
+ * @param value
+ */
+DigitalFast_INLINE void DigitalFast_write(PinName pin, int32_t value){
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+	DigitalFast_PORT(pin)->MASKED_ACCESS[GET_MASK_NUM(pin)] = value ? GET_MASK_NUM(pin) : 0;
+#elif defined (TARGET_LPC17XX)
+	if (value)
+		DigitalFast_PORT(pin)->FIOSET = GET_MASK_NUM(pin);
+	else
+		DigitalFast_PORT(pin)->FIOCLR = GET_MASK_NUM(pin);
+#endif
+}
+
+/**
+ * Inverts the level of pin.
+ *
+ * @param pin
+ */
+DigitalFast_INLINE void DigitalFast_toggle(PinName pin){
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+	DigitalFast_PORT(pin)->MASKED_ACCESS[GET_MASK_NUM(pin)] ^= GET_MASK_NUM(pin);
+#elif defined (TARGET_LPC17XX)
+	/* FIOSET/FIOCLR touch only this pin, an RMW of FIOPIN could undo other pins changed by an interrupt */
+	if(DigitalFast_PORT(pin)->FIOPIN & GET_MASK_NUM(pin)){
+		DigitalFast_PORT(pin)->FIOCLR = GET_MASK_NUM(pin);
+	}else{
+		DigitalFast_PORT(pin)->FIOSET = GET_MASK_NUM(pin);
+	}
+#endif
+}
+
+/**
+ * Reads value of pin.
+ *
+ * @param pin
+ * @return 1 if has high level on pin, 0 if has low level on pin.
+ */
+DigitalFast_INLINE uint8_t DigitalFast_read(PinName pin){
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+	return DigitalFast_PORT(pin)->MASKED_ACCESS[GET_MASK_NUM(pin)] ? 1 : 0;
+#elif defined (TARGET_LPC17XX)
+	return (DigitalFast_PORT(pin)->FIOPIN & GET_MASK_NUM(pin)) ? 1 : 0;
+#endif
+}
+
+#endif
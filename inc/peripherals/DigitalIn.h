@@ -11,10 +11,33 @@
 #define _DIGITAL_IN_H_
 
 #include "core/PinNames.h"
+#include "core/Types.h"
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+#include "peripherals/HardwareTimer.h"
+#endif
+
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+#define DigitalIn_PORTS				4
+#elif defined (TARGET_LPC17XX)
+#define DigitalIn_PORTS				5
+#endif
+
+#define DigitalIn_DEBOUNCE_SAMPLES	4	/* Equal samples needed to change a debounced pin (2 bits vertical counter) */
 
 void DigitalIn_Init(PinName pin);
 uint8_t DigitalIn_read (PinName pin);
 
+void DigitalIn_enableDebounce(PinName pin);
+void DigitalIn_disableDebounce(PinName pin);
+void DigitalIn_debounceTick();
+uint8_t DigitalIn_readDebounced(PinName pin);
+uint32_t DigitalIn_readDebouncedPort(uint8_t portNum);
+uint32_t DigitalIn_getRisingEdges(uint8_t portNum);
+uint32_t DigitalIn_getFallingEdges(uint8_t portNum);
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+void DigitalIn_startDebounce(HardwareTimerNum timerNum, uint32_t interval_us);
+#endif
+
 
 #endif
 
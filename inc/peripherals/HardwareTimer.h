@@ -12,6 +12,11 @@
 
 #include "core/Types.h"
 #include "core/cmsis.h"
+#include "core/PinNames.h"
+
+#if defined (TARGET_LPC17XX)
+typedef LPC_TIM_TypeDef LPC_TMR_TypeDef;	/* Same timer registers, named TIM in the LPC17xx header */
+#endif
 
 
 typedef enum {
@@ -52,6 +57,7 @@ if SystemFrequency = 60Mhz, SystemAHBFrequency = 1/4 SystemAHBFrequency,
 
 
 LPC_TMR_TypeDef* HardwareTimer_getLPC_TMR(HardwareTimerNum timerNum);
+IRQn_Type HardwareTimer_getIRQn(HardwareTimerNum timerNum);
 
 void HardwareTimer_default_handler(HardwareTimerNum timerNum);
 
@@ -59,10 +65,17 @@ void HardwareTimer_enable(HardwareTimerNum timerNum);
 void HardwareTimer_disable(HardwareTimerNum timerId);
 void HardwareTimer_reset(HardwareTimerNum timerNum);
 void HardwareTimer_Init(HardwareTimerNum timerNum, uint32_t timerInterval);
+void HardwareTimer_InitFreeRunning(HardwareTimerNum timerNum);
+uint32_t HardwareTimer_read(HardwareTimerNum timerNum);
 
 void HardwareTimer_delay_uS(HardwareTimerNum timerNum, uint32_t delay_uS);
+void HardwareTimer_sleep_uS(HardwareTimerNum timerNum, uint32_t delay_uS);
+void HardwareTimer_delayAsync_uS(HardwareTimerNum timerNum, uint32_t delay_uS, FunctionPointer handler);
+bool HardwareTimer_isDelayRunning(HardwareTimerNum timerNum);
+void HardwareTimer_delay_nS(uint32_t delay_nS);
 
 void HardwareTimer_setUserHandler(HardwareTimerNum timerNum, FunctionPointer ptr);
+void HardwareTimer_setContextHandler(HardwareTimerNum timerNum, ContextFunctionPointer ptr, void* context);
 
 
 
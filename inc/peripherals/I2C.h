@@ -72,6 +72,8 @@ void I2C_Init(I2CPortNum port);
 void I2C_default_handler(I2CPortNum port);
 bool I2C_start(I2CPortNum port);
 void I2C_stop(I2CPortNum port);
+void I2C_setUserHandler(I2CPortNum port, FunctionPointer ptr);
+void I2C_setContextHandler(I2CPortNum port, ContextFunctionPointer ptr, void* context);
 
 void I2C_write(I2CPortNum port, uint8_t deviceAddress, uint8_t* data, uint32_t size);
 //uint32_t I2C_read(I2CPortNum port, uint8_t deviceAddress, uint8_t* rxBuffer, uint32_t bufferSize, uint32_t bytesToRead);
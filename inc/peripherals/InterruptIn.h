@@ -24,6 +24,7 @@
 #define _INTERRUPT_IN_H_
 
 #include "core/PinNames.h"
+#include "peripherals/HardwareTimer.h"
 
 typedef enum{
 	EDGE,
@@ -40,6 +41,15 @@ typedef enum{
 	RISING_EDGE_OR_HIGH_LEVEL
 }InterruptEvent;
 
+/* Edge recorded by the event queue, timestamp is in microseconds of the queue timer */
+typedef struct{
+	PinName pin;
+	uint8_t level;
+	uint32_t timestamp;
+}InterruptInEvent;
+
+typedef void (*InterruptInEventHandler)(const InterruptInEvent* event);
+
 void InterruptIn_Init (PinName pin);
 void InterruptIn_configure (PinName pin, InterruptSense sense, InterruptEdge edge, InterruptEvent event);
 void InterruptIn_enable (PinName pin);
@@ -47,7 +57,23 @@ void InterruptIn_disable (PinName pin);
 int32_t InterruptIn_read (PinName pin);
 void InterruptIn_clear (PinName pin);
 void InterruptIn_default_handler(PinName pin);
+void InterruptIn_port_handler(uint8_t portNum);
 void InterruptIn_setUserHandler(PinName pin, FunctionPointer usrHandler);
+void InterruptIn_setContextHandler(PinName pin, ContextFunctionPointer usrHandler, void* context);
+
+void InterruptIn_enableEventQueue(HardwareTimerNum timerNum, InterruptInEvent* buffer, uint16_t size);
+void InterruptIn_queueEvents(PinName pin, bool enable);
+uint8_t InterruptIn_getEvent(InterruptInEvent* event);
+uint16_t InterruptIn_processEvents(InterruptInEventHandler handler);
+uint32_t InterruptIn_getLostEvents(void);
+
+void InterruptIn_setRateLimit(PinName pin, uint8_t maxEvents);
+void InterruptIn_rateLimitTick();
+uint16_t InterruptIn_getLimitCount(PinName pin);
+bool InterruptIn_isThrottled(PinName pin);
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+void InterruptIn_startRateLimiter(HardwareTimerNum timerNum, uint32_t window_us);
+#endif
 
 
 #endif
@@ -0,0 +1,49 @@
+/**************************************************************************//**
+ *
+ * @file     PortCapture.h
+ * @author	 David Alain <dnascimento@fitec.org.br>
+ * @brief    Logic analyzer: captures a GPIO port into RAM and exports it over Serial.
+ * @version  V1.0
+ *
+ ******************************************************************************/
+
+#ifndef _PORT_CAPTURE_H_
+#define _PORT_CAPTURE_H_
+
+#include "core/PinNames.h"
+#include "core/Types.h"
+#include "peripherals/Serial.h"
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+#include "peripherals/HardwareTimer.h"
+#endif
+
+#define PortCapture_EXPORT_MAGIC	0x414C		/* "LA" in little endian, first bytes of PortCapture_export */
+
+typedef enum {
+	CAPTURE_TRIGGER_NONE,		/* Triggers on the first sample */
+	CAPTURE_TRIGGER_PATTERN,	/* (sample & mask) == pattern */
+	CAPTURE_TRIGGER_RISING,		/* Any pin of mask goes from low to high */
+	CAPTURE_TRIGGER_FALLING,	/* Any pin of mask goes from high to low */
+	CAPTURE_TRIGGER_EDGE		/* Any pin of mask changes */
+}PortCaptureTrigger;
+
+typedef enum {
+	CAPTURE_IDLE,
+	CAPTURE_ARMED,				/* Filling the pre-trigger samples, waiting for the trigger */
+	CAPTURE_TRIGGERED,			/* Filling the post-trigger samples */
+	CAPTURE_DONE
+}PortCaptureState;
+
+void PortCapture_Init(uint8_t portNum, uint8_t firstPin, uint16_t* allocatedBuffer, uint16_t bufferSize, uint16_t preTrigger);
+void PortCapture_setTrigger(PortCaptureTrigger trigger, uint16_t mask, uint16_t pattern);
+void PortCapture_arm();
+void PortCapture_sample();
+bool PortCapture_captureLoop(uint32_t delayLoops, uint32_t timeoutSamples);
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+void PortCapture_start(HardwareTimerNum timerNum, uint32_t interval_us);
+#endif
+PortCaptureState PortCapture_getState();
+uint16_t PortCapture_read(uint16_t* samples, uint16_t maxSamples);
+void PortCapture_export(SerialPortNum portNum);
+
+#endif
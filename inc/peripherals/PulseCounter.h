@@ -0,0 +1,33 @@
+/**************************************************************************//**
+ *
+ * @file     PulseCounter.h
+ * @author	 David Alain <dnascimento@fitec.org.br>
+ * @brief    Counts pulses in hardware with the timers in counter mode and decodes quadrature encoders.
+ * @version  V1.0
+ *
+ ******************************************************************************/
+
+#ifndef _PULSE_COUNTER_H_
+#define _PULSE_COUNTER_H_
+
+#include "core/PinNames.h"
+#include "core/Types.h"
+#include "peripherals/HardwareTimer.h"
+
+/* Values of the CTCR counter/timer mode field */
+typedef enum {
+	PULSE_COUNTER_RISING = 1,
+	PULSE_COUNTER_FALLING = 2,
+	PULSE_COUNTER_BOTH_EDGES = 3
+}PulseCounterEdge;
+
+PinName PulseCounter_getInputPin(HardwareTimerNum timerNum);
+void PulseCounter_Init(HardwareTimerNum timerNum, PulseCounterEdge edge);
+uint32_t PulseCounter_read(HardwareTimerNum timerNum);
+void PulseCounter_reset(HardwareTimerNum timerNum);
+
+void PulseCounter_initQuadrature(HardwareTimerNum counterA, HardwareTimerNum counterB, PinName directionPin);
+int32_t PulseCounter_readPosition();
+void PulseCounter_resetPosition();
+
+#endif
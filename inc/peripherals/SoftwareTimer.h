@@ -23,6 +23,9 @@
 #define _SOFTWARE_TIMER_H_
 
 #include "core/Types.h"
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+#include "peripherals/HardwareTimer.h"
+#endif
 
 typedef enum {
 	STATE_DISABLE,
@@ -31,9 +34,13 @@ typedef enum {
 } SoftwareTimerState;
 
 uint16_t SoftwareTimer_Init(uint16_t timerId, uint32_t timeInterval_us, FunctionPointer userHandler);
+uint16_t SoftwareTimer_InitContext(uint16_t timerId, uint32_t timeInterval_us, ContextFunctionPointer userHandler, void* context);
 SoftwareTimerState SoftwareTimer_getState(uint16_t timerId);
 void SoftwareTimer_reset(uint16_t timerId);
 void SoftwareTimer_start(uint16_t timerId);
 void SoftwareTimer_stop(uint16_t timerId);
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+void SoftwareTimer_startTickless(HardwareTimerNum timerNum);
+#endif
 
 #endif /* SOFTWARETIMER_H_ */
@@ -0,0 +1,31 @@
+/**************************************************************************//**
+ *
+ * @file     Timebase.h
+ * @author	 David Alain <dnascimento@fitec.org.br>
+ * @brief    Monotonic 64 bit microsecond time base on a free-running 32 bit timer.
+ * @version  V1.0
+ *
+ ******************************************************************************/
+
+#ifndef _TIMEBASE_H_
+#define _TIMEBASE_H_
+
+#include "core/Types.h"
+#include "peripherals/HardwareTimer.h"
+
+/* Durations in microseconds, the unit of the time base */
+#define Timebase_MS(ms)			((uint64_t)(ms) * 1000)
+#define Timebase_S(s)			((uint64_t)(s) * 1000000)
+
+void Timebase_Init(HardwareTimerNum timerNum);
+uint64_t Timebase_read();
+uint32_t Timebase_read32();
+uint64_t Timebase_millis();
+
+uint32_t Timebase_elapsed32(uint32_t since);
+bool Timebase_expired32(uint32_t since, uint32_t duration_us);
+
+uint64_t Timebase_toMillis(uint64_t time_us);
+uint32_t Timebase_toSeconds(uint64_t time_us);
+
+#endif
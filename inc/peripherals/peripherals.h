@@ -25,19 +25,27 @@
 //Include common peripherals
 #include "peripherals/DigitalIn.h"
 #include "peripherals/DigitalOut.h"
+#include "peripherals/DigitalFast.h"
+#include "peripherals/BusIn.h"
+#include "peripherals/BusOut.h"
 #include "peripherals/InterruptIn.h"
 #include "peripherals/AnalogIn.h"
 #include "peripherals/SoftwareTimer.h"
 #include "peripherals/Serial.h"
 #include "peripherals/I2C.h"
+#include "peripherals/PortCapture.h"
 
 #if defined (TARGET_LPC111X)
 
 //Include specific peripherals
+#include "peripherals/PulseCounter.h"
+#include "peripherals/Timebase.h"
 
 #elif defined (TARGET_LPC13XX)
 
 //Include specific peripherals
+#include "peripherals/PulseCounter.h"
+#include "peripherals/Timebase.h"
 
 #elif defined (TARGET_LPC17XX)
 
@@ -53,6 +53,7 @@ extern LPC_GPIO_TypeDef (* const LPC_GPIO[5]);
 
 
 FunctionPointer _userHandlerPtr[ NUMBER_IO_PINS ];
+ContextHandler _userContextHandler[ NUMBER_IO_PINS ];
 
 //*****************************************************************************
 #if defined (__cplusplus)
@@ -112,6 +113,12 @@ void PIOINT0_IRQ_handler(void);
 void PIOINT1_IRQ_handler(void);
 void PIOINT2_IRQ_handler(void);
 void PIOINT3_IRQ_handler(void);
+#if defined (TARGET_LPC17XX)
+void EINT0_IRQ_handler(void);
+void EINT1_IRQ_handler(void);
+void EINT2_IRQ_handler(void);
+void EINT3_IRQ_handler(void);
+#endif
 void USB_IRQ_handler(void);
 void USB_FIQ_handler(void);
 void USBActivity_IRQ_handler(void);
@@ -555,69 +562,38 @@ void WDT_IRQ_handler(void){
 void BOD_IRQ_handler(void){
 	while(1);
 }
-void PIOINT0_IRQ_handler(void){
-	uint32_t status = LPC_GPIO[0]->MIS;
-
-	switch(status){
-	case 0x001: InterruptIn_default_handler(P0_0); break;
-	case 0x002: InterruptIn_default_handler(P0_1); break;
-	case 0x004: InterruptIn_default_handler(P0_2); break;
-	case 0x008: InterruptIn_default_handler(P0_3); break;
-	case 0x010: InterruptIn_default_handler(P0_4); break;
-	case 0x020: InterruptIn_default_handler(P0_5); break;
-	case 0x040: InterruptIn_default_handler(P0_6); break;
-	case 0x080: InterruptIn_default_handler(P0_7); break;
-	case 0x100: InterruptIn_default_handler(P0_8); break;
-	case 0x200: InterruptIn_default_handler(P0_9); break;
-	case 0x400: InterruptIn_default_handler(P0_10); break;
-	case 0x800: InterruptIn_default_handler(P0_11); break;
+#if defined (TARGET_LPC17XX)
+void EINT0_IRQ_handler(void){
+
+}
+void EINT1_IRQ_handler(void){
+
+}
+void EINT2_IRQ_handler(void){
+
+}
+void EINT3_IRQ_handler(void){
+	uint32_t pending = LPC_GPIOINT->IntStatus;	// Bit 0 for port 0, bit 2 for port 2
+
+	if(pending & 0x1){
+		InterruptIn_port_handler(0);
+	}
+	if(pending & 0x4){
+		InterruptIn_port_handler(2);
 	}
 }
+#endif
+void PIOINT0_IRQ_handler(void){
+	InterruptIn_port_handler(0);
+}
 void PIOINT1_IRQ_handler(void){
-	uint32_t status = LPC_GPIO[1]->MIS;
-
-	switch(status){
-	case 0x001: InterruptIn_default_handler(P1_0); break;
-	case 0x002: InterruptIn_default_handler(P1_1); break;
-	case 0x004: InterruptIn_default_handler(P1_2); break;
-	case 0x008: InterruptIn_default_handler(P1_3); break;
-	case 0x010: InterruptIn_default_handler(P1_4); break;
-	case 0x020: InterruptIn_default_handler(P1_5); break;
-	case 0x040: InterruptIn_default_handler(P1_6); break;
-	case 0x080: InterruptIn_default_handler(P1_7); break;
-	case 0x100: InterruptIn_default_handler(P1_8); break;
-	case 0x200: InterruptIn_default_handler(P1_9); break;
-	case 0x400: InterruptIn_default_handler(P1_10); break;
-	case 0x800: InterruptIn_default_handler(P1_11); break;
-	}
+	InterruptIn_port_handler(1);
 }
 void PIOINT2_IRQ_handler(void){
-	uint32_t status = LPC_GPIO[2]->MIS;
-
-	switch(status){
-	case 0x001: InterruptIn_default_handler(P2_0); break;
-	case 0x002: InterruptIn_default_handler(P2_1); break;
-	case 0x004: InterruptIn_default_handler(P2_2); break;
-	case 0x008: InterruptIn_default_handler(P2_3); break;
-	case 0x010: InterruptIn_default_handler(P2_4); break;
-	case 0x020: InterruptIn_default_handler(P2_5); break;
-	case 0x040: InterruptIn_default_handler(P2_6); break;
-	case 0x080: InterruptIn_default_handler(P2_7); break;
-	case 0x100: InterruptIn_default_handler(P2_8); break;
-	case 0x200: InterruptIn_default_handler(P2_9); break;
-	case 0x400: InterruptIn_default_handler(P2_10); break;
-	case 0x800: InterruptIn_default_handler(P2_11); break;
-	}
+	InterruptIn_port_handler(2);
 }
 void PIOINT3_IRQ_handler(void){
-	uint32_t status = LPC_GPIO[3]->MIS;
-
-	switch(status){
-	case 0x001: InterruptIn_default_handler(P3_0); break;
-	case 0x002: InterruptIn_default_handler(P3_1); break;
-	case 0x004: InterruptIn_default_handler(P3_2); break;
-	case 0x008: InterruptIn_default_handler(P3_3); break;
-	}
+	InterruptIn_port_handler(3);
 }
 void USB_IRQ_handler(void){
 
@@ -640,8 +616,14 @@ void PLL1_IRQ_handler(void){
 void RTC_IRQ_handler(void){
 
 }
-void DMA_IRQ_handler(void){
+#if defined (TARGET_LPC17XX)
+extern void AnalogIn_DMA_default_handler();
+#endif
 
+void DMA_IRQ_handler(void){
+#if defined (TARGET_LPC17XX)
+	AnalogIn_DMA_default_handler();
+#endif
 }
 void I2S_IRQ_handler(void){
 
@@ -18,13 +18,105 @@
 
 
 #define ADC_CHANNELS	8
+#define ADC_NO_CHANNEL	0xFF
+#define ADC_MAX_GAIN_INPUT	((0x1 << 23) - 1)	/* Largest |raw - offset| the 32 bit Q16 gain step handles */
 
 static uint32_t _clock;
-static bool _useIRQ;
 static bool _enabledADC[ADC_CHANNELS] = {false};
 static uint32_t _readedValue[ADC_CHANNELS] = {0};
 
+static uint32_t _irqChannels = 0;					/* Channels sampled in background by interruption */
+static uint32_t _scanChannels = 0;					/* Channels queued by each AnalogIn_startConversion */
+static volatile uint32_t _pendingChannels = 0;		/* Background conversions waiting for the converter */
+static volatile uint8_t _busyChannel = ADC_NO_CHANNEL;	/* Background conversion running in the converter */
+static volatile uint8_t _foregroundDepth = 0;		/* Nested AnalogIn_acquire calls owning the converter */
+static uint8_t _lastChannel = ADC_CHANNELS - 1;		/* Last background channel served, for round-robin */
+
+typedef struct {
+	uint8_t extraBits;		/* Output has (ADC resolution + extraBits) bits, 0 disables oversampling */
+	AnalogInFilter filter;
+	uint8_t warmup;			/* Outputs to discard while the CIC comb stages fill up */
+	uint16_t count;			/* Conversions accumulated in the current output period */
+	uint32_t integrator[2];
+	uint32_t comb[2];
+} AnalogInDecimator;
+
+static AnalogInDecimator _decimator[ADC_CHANNELS];
+
+typedef struct {
+	AnalogInSample* buffer;
+	uint16_t size;
+	volatile uint16_t head;		/* Written only by AnalogIn_default_handler */
+	volatile uint16_t tail;		/* Written only by AnalogIn_readSamples */
+	volatile uint32_t overruns;
+} AnalogInSampleFifo;
+
+static AnalogInSampleFifo _fifo[ADC_CHANNELS];
+
+typedef struct {
+	bool enabled;
+	uint32_t low;
+	uint32_t high;
+	uint32_t hysteresis;
+	volatile AnalogInZone zone;
+} AnalogInWindow;
+
+static AnalogInWindow _window[ADC_CHANNELS];
+
+typedef struct {
+	int32_t offset;			/* Raw counts subtracted before the gain */
+	int32_t gain;			/* Q16 multiplier, 0x10000 = 1.0 */
+	const int32_t* table;	/* Optional piecewise-linear table, NULL when not used */
+	uint8_t tableBits;		/* log2 of the counts between two table points */
+	uint8_t tableSize;		/* Number of points in table */
+} AnalogInCalibration;
+
+static AnalogInCalibration _calibration[ADC_CHANNELS] = {
+		{0, AnalogIn_Q16_ONE, NULL, 0, 0}, {0, AnalogIn_Q16_ONE, NULL, 0, 0},
+		{0, AnalogIn_Q16_ONE, NULL, 0, 0}, {0, AnalogIn_Q16_ONE, NULL, 0, 0},
+		{0, AnalogIn_Q16_ONE, NULL, 0, 0}, {0, AnalogIn_Q16_ONE, NULL, 0, 0},
+		{0, AnalogIn_Q16_ONE, NULL, 0, 0}, {0, AnalogIn_Q16_ONE, NULL, 0, 0}
+};
+static volatile uint32_t* _timestampCounter = NULL;
+
+#if defined (TARGET_LPC17XX)
+typedef struct {
+	uint32_t srcAddr;
+	uint32_t destAddr;
+	uint32_t nextLLI;
+	uint32_t control;
+} AnalogInDmaLLI;
+
+static AnalogInDmaLLI _dmaLLI[2];				/* Two linked blocks that reload each other */
+static uint32_t* _dmaBlock[2];
+static volatile uint8_t _dmaCompletedBlock = 0;
+static FunctionPointer _dmaBlockHandler = NULL;
+static bool _dmaRunning = false;				/* The converter belongs to the DMA BURST scan */
+#endif
+
 extern FunctionPointer _userHandlerPtr[NUMBER_IO_PINS];
+extern ContextHandler _userContextHandler[NUMBER_IO_PINS];
+
+/* Analog pins and their AD channels, expanded by each ENTRY(pin, channel) */
+#define AnalogIn_CHANNEL_PINS(ENTRY)	\
+		ENTRY(AD0, 0) ENTRY(AD1, 1) ENTRY(AD2, 2) ENTRY(AD3, 3)	\
+		ENTRY(AD4, 4) ENTRY(AD5, 5) ENTRY(AD6, 6) ENTRY(AD7, 7)
+
+#define AnalogIn_CHANNEL_OF_PIN(pin, channel)		[GET_PIN_INDEX(pin)] = (channel) + 1,
+#define AnalogIn_CHANNEL_IN_RANGE(pin, channel)		STATIC_ASSERT((channel) < ADC_CHANNELS, AnalogIn_##pin##_channel_out_of_range);
+
+/* AD channel + 1 of each pin (0 = not an analog pin), indexed by GET_PIN_INDEX */
+static const uint8_t _channelOfPin[NUMBER_IO_PINS] = {
+		AnalogIn_CHANNEL_PINS(AnalogIn_CHANNEL_OF_PIN)
+};
+
+AnalogIn_CHANNEL_PINS(AnalogIn_CHANNEL_IN_RANGE)
+
+STATIC_ASSERT(sizeof(_channelOfPin) / sizeof(_channelOfPin[0]) == NUMBER_IO_PINS, AnalogIn_channelOfPin_must_cover_every_pin);
+
+static const PinName _pinOfChannel[ADC_CHANNELS] = { AD0, AD1, AD2, AD3, AD4, AD5, AD6, AD7 };
+
+STATIC_ASSERT(sizeof(_pinOfChannel) / sizeof(_pinOfChannel[0]) == ADC_CHANNELS, AnalogIn_pinOfChannel_must_cover_every_channel);
 
 /******************************************************************************************
  *
@@ -37,8 +129,9 @@ extern LPC_GPIO_TypeDef (* const LPC_GPIO[4]);
 #elif defined (TARGET_LPC17XX)
 extern LPC_GPIO_TypeDef (* const LPC_GPIO[5]);
 #endif
-
+
 #if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+extern volatile uint32_t* Digital_getIOConfigRegister(PinName pin);
 volatile uint32_t* AnalogIn_getLPC_IOCON_PIO(PinName pin);
 #elif defined (TARGET_LPC17XX)
 uint32_t AnalogIn_readLPC_ADC_ADDRn(uint8_t channel);
@@ -47,6 +140,13 @@ uint32_t AnalogIn_readLPC_ADC_ADDRn(uint8_t channel);
 uint8_t AnalogIn_getChannelNum(PinName pin);
 PinName AnalogIn_getPinName(uint8_t pin);
 uint32_t AnalogIn_readLPC_ADC_Value(PinName pin);
+int32_t AnalogIn_readRaw(PinName pin);
+bool AnalogIn_decimate(uint8_t channel, uint32_t sample, uint32_t* result);
+void AnalogIn_pushSample(uint8_t channel, uint32_t timestamp, uint32_t value);
+bool AnalogIn_updateZone(uint8_t channel, uint32_t value);
+void AnalogIn_convertNext();
+void AnalogIn_acquire(uint32_t urgentChannels);
+void AnalogIn_release();
 
 
 
@@ -60,12 +160,17 @@ uint32_t AnalogIn_readLPC_ADC_Value(PinName pin);
  * Initializes the Analog to Digital peripheral and configures this pin to analog input.
  *
  * @param pin PinName related to AD channel
- * @param useIRQ Defines if the AD reading is by interruption or blocking;
+ * @param useIRQ Defines if the AD reading of this channel is by interruption or blocking;
  *
- * When useIRQ is true, the start and stop control of conversions must be do by the user (using AnalogIn_startConversion and AnalogIn_stopConversion functions);
+ * The acquisition mode is kept per channel, so background and polled channels can be mixed on the same ADC.
+ *
+ * When useIRQ is true, the channel is converted in background: each call to AnalogIn_startConversion queues one
+ * conversion of every interrupt channel, and the driver runs them one after the other in the interrupt handler.
  * Using useIRQ equals to true the last conversation result is stored in a global variable an returned when getting.
  *
  * When useIRQ is false, the conversion is locking and return only the conversion is finished.
+ * A blocking read has priority over the background queue: it waits only for the conversion already running
+ * in the converter (if any), and the queue continues afterwards.
  *
  * @see PinName
  * @see bool
@@ -73,7 +178,11 @@ uint32_t AnalogIn_readLPC_ADC_Value(PinName pin);
 void AnalogIn_Init(PinName pin, bool useIRQ)
 {
 	uint8_t channel = AnalogIn_getChannelNum(pin);
-	_useIRQ = useIRQ;
+
+	if(channel == AnalogIn_INVALID_CHANNEL){
+		return;
+	}
+
 	_enabledADC[channel] = true;
 
 	NVIC_DisableIRQ(ADC_IRQn);
@@ -81,72 +190,89 @@ void AnalogIn_Init(PinName pin, bool useIRQ)
 #if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
 
 	/* Disable Power down bit to the ADC block. */
-	CLEAR_BIT(LPC_SYSCON->PDRUNCFG, 4);
+	BITBAND_CLEAR_BIT(LPC_SYSCON->PDRUNCFG, 4);
 
 	/* Enable AHB clock to the ADC. */
-	SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 13);
+	BITBAND_SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 13);
 	/* enable clock for GPIO      */
-	SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 6);
+	BITBAND_SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 6);
 	/* enable clock for IOCON     */
-	SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 16);
+	BITBAND_SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 16);
 
 	volatile uint32_t* lpc_iocon_pioReg = AnalogIn_getLPC_IOCON_PIO(pin);
 
+	if(lpc_iocon_pioReg == NULL){
+		return;
+	}
+
 	(*lpc_iocon_pioReg) &= ~0x8F;	/* Clear last configuration */
 	(*lpc_iocon_pioReg) |= (0x02);	/* Set to AD */
 
 	uint32_t portNum = GET_PORT_NUM(pin);
 	uint32_t mask = GET_MASK_NUM(pin);
 
-#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
 	LPC_GPIO[portNum]->DIR &= ~mask; 	/* configure GPIO as input */
-#elif defined (TARGET_LPC17XX)
-	LPC_GPIO[portNum]->FIODIR &= ~mask;	/* configure GPIO as input */
-#endif
+
+	BITBAND_CLEAR_BIT(LPC_ADC->INTEN, 8);		/* Only the channels enabled in INTEN 7:0 generate interrupts */
 
 #elif defined (TARGET_LPC17XX)
 
+	/* PINSEL function of AD0.0~7: P0.23~26 = 01, P1.30~31 = 11, P0.3~2 = 10 */
+	static const uint8_t pinFunction[ADC_CHANNELS] = {1, 1, 1, 1, 3, 3, 2, 2};
+
+	uint32_t portNum = GET_PORT_NUM(pin);
+	uint32_t mask = GET_MASK_NUM(pin);
+	uint32_t regIndex = (portNum * 2) + ((pin & 0x1F) >> 4);	/* PINSELn/PINMODEn hold 16 pins each */
+	uint32_t shift = (pin & 0x0F) * 2;
+
 	/* Enable CLOCK into ADC controller */
-	LPC_SC->PCONP |= (1 << 12);
+	BITBAND_SET_BIT(LPC_SC->PCONP, 12);
+
+	/* Only this pin is set to ADC input */
+	(&LPC_PINCON->PINSEL0)[regIndex] = ((&LPC_PINCON->PINSEL0)[regIndex] & ~(0x3 << shift)) | (pinFunction[channel] << shift);
+	/* Neither pull-up nor pull-down (10b) */
+	(&LPC_PINCON->PINMODE0)[regIndex] = ((&LPC_PINCON->PINMODE0)[regIndex] & ~(0x3 << shift)) | (0x2 << shift);
 
-	/* all the related pins are set to ADC inputs, AD0.0~7 */
-	LPC_PINCON->PINSEL0 |= 0x0F000000;	/* P0.12~13, A0.6~7, function 11 */
-	LPC_PINCON->PINSEL1 &= ~0x003FC000;	/* P0.23~26, A0.0~3, function 01 */
-	LPC_PINCON->PINSEL1 |= 0x00154000;
-	LPC_PINCON->PINSEL3 |= 0xF0000000;	/* P1.30~31, A0.4~5, function 11 */
+	LPC_GPIO[portNum]->FIODIR &= ~mask;	/* configure GPIO as input */
+
+	BITBAND_CLEAR_BIT(LPC_ADC->ADINTEN, 8);	/* ADGINTEN = 0, only the channels enabled in ADINTEN 7:0 generate interrupts */
 
 #endif
 
 	AnalogIn_setClock(AnalogIn_DEFAULT_CLOCK); //Default clock
 	//LPC_ADC->CR |= (23 << 8);
 
-	if(_useIRQ){
-
-		NVIC_EnableIRQ(ADC_IRQn);
+	if(useIRQ){
 
-		uint8_t channel = AnalogIn_getChannelNum(pin);
+		_irqChannels |= (0x1 << channel);
 
 #if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
-		LPC_ADC->INTEN |= (1 << 8) | (0x1 << channel);		/* Enable Global ADC interrupts and for this channel too */
+		BITBAND_SET_BIT(LPC_ADC->INTEN, channel);	/* Enable ADC interrupts for this channel */
 #elif defined (TARGET_LPC17XX)
-		LPC_ADC->ADINTEN |= 0x1 << channel;	/* Enable ADC interrupts for this channel*/
+		BITBAND_SET_BIT(LPC_ADC->ADINTEN, channel);	/* Enable ADC interrupts for this channel */
 #endif
 
-		LPC_ADC->CR |= 1 << channel;
+		AnalogIn_enableConversion(pin);
 
 		//AnalogIn_startConversion();
 	}else{
 
-		NVIC_DisableIRQ(ADC_IRQn);
+		_irqChannels &= ~(0x1 << channel);
+		_pendingChannels &= ~(0x1 << channel);
+		AnalogIn_disableConversion(pin);
 
 #if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
-		LPC_ADC->INTEN = 0x00;		/* Disable all ADC interrupts */
+		BITBAND_CLEAR_BIT(LPC_ADC->INTEN, channel);	/* Disable ADC interrupts only for this channel */
 #elif defined (TARGET_LPC17XX)
-		LPC_ADC->ADINTEN = 0x00;		/* Disable all ADC interrupts */
+		BITBAND_CLEAR_BIT(LPC_ADC->ADINTEN, channel);	/* Disable ADC interrupts only for this channel */
 #endif
 
 	}
 
+	if(_irqChannels != 0){
+		NVIC_EnableIRQ(ADC_IRQn);
+	}
+
 }
 
 
@@ -158,9 +284,503 @@ void AnalogIn_Init(PinName pin, bool useIRQ)
  */
 void AnalogIn_setUserHandler(PinName pin, FunctionPointer usrHandler){
 	uint8_t pinIndex = GET_PIN_INDEX(pin);
+
+	if(AnalogIn_getChannelNum(pin) == AnalogIn_INVALID_CHANNEL){
+		return;
+	}
+
 	_userHandlerPtr[pinIndex] = usrHandler;
+	_userContextHandler[pinIndex].function = NULL;
 }
 
+/**
+ * Sets a user function that receives context, the pin and the converted value when a end conversion
+ * interrupt is generated. Replaces the handler set with AnalogIn_setUserHandler.
+ *
+ * @param pin PinName related to AD channel
+ * @param usrHandler user function
+ * @param context pointer passed back unchanged to usrHandler
+ */
+void AnalogIn_setContextHandler(PinName pin, ContextFunctionPointer usrHandler, void* context){
+	uint8_t pinIndex = GET_PIN_INDEX(pin);
+
+	if(AnalogIn_getChannelNum(pin) == AnalogIn_INVALID_CHANNEL){
+		return;
+	}
+
+	_userHandlerPtr[pinIndex] = NULL;
+	_userContextHandler[pinIndex].context = context;
+	_userContextHandler[pinIndex].function = usrHandler;
+}
+
+
+/**
+ * Enables hardware oversampling and decimation on the AD channel related to pin.
+ * Each output value is computed from 4^extraBits conversions, so the result has extraBits more bits
+ * than the ADC resolution (e.g. extraBits = 2 returns 12 bits results from the 10 bits LPC13xx ADC).
+ * Only integer arithmetic is used.
+ *
+ * When the channel uses interruption, the driver restarts the conversions by itself and the user handler
+ * is called once per output value, not once per conversion.
+ *
+ * @param pin PinName related to AD channel
+ * @param extraBits Number of additional bits of resolution, from 0 (disabled) up to AnalogIn_MAX_OVERSAMPLING_BITS.
+ * @param filter Decimation filter used to combine the conversions.
+ *
+ * @see AnalogInFilter
+ */
+void AnalogIn_setOversampling(PinName pin, uint8_t extraBits, AnalogInFilter filter){
+	uint8_t channel = AnalogIn_getChannelNum(pin);
+	AnalogInDecimator* decimator;
+
+	if(channel == AnalogIn_INVALID_CHANNEL){
+		return;
+	}
+
+	decimator = &_decimator[channel];
+
+	if(extraBits > AnalogIn_MAX_OVERSAMPLING_BITS){
+		extraBits = AnalogIn_MAX_OVERSAMPLING_BITS;
+	}
+
+	decimator->extraBits = extraBits;
+	decimator->filter = filter;
+	decimator->warmup = (filter == ANALOG_FILTER_CIC) ? 1 : 0;
+	decimator->count = 0;
+	decimator->integrator[0] = 0;
+	decimator->integrator[1] = 0;
+	decimator->comb[0] = 0;
+	decimator->comb[1] = 0;
+}
+
+/**
+ * Enables the window comparator of the AD channel related to pin.
+ * Every conversion is compared against the thresholds inside the interrupt handler and the user handler
+ * is called only when the value crosses into another zone, instead of on every conversion.
+ *
+ * To leave the low zone the value must rise to lowThreshold + hysteresis, and to leave the high zone it must
+ * fall to highThreshold - hysteresis, so a noisy signal around a threshold does not fire repeated events.
+ * The thresholds are in the same unit returned by AnalogIn_read (decimated value if oversampling is enabled).
+ *
+ * @param pin PinName related to AD channel
+ * @param lowThreshold Values below it are in ANALOG_ZONE_LOW.
+ * @param highThreshold Values above it are in ANALOG_ZONE_HIGH.
+ * @param hysteresis Distance the value must come back before leaving a zone.
+ *
+ * @see AnalogIn_getZone
+ * @see AnalogIn_setUserHandler
+ */
+void AnalogIn_setWindow(PinName pin, uint32_t lowThreshold, uint32_t highThreshold, uint32_t hysteresis){
+	uint8_t channel = AnalogIn_getChannelNum(pin);
+	AnalogInWindow* window;
+
+	if(channel == AnalogIn_INVALID_CHANNEL){
+		return;
+	}
+
+	window = &_window[channel];
+
+	window->enabled = false;
+	window->low = lowThreshold;
+	window->high = highThreshold;
+	window->hysteresis = hysteresis;
+	window->zone = ANALOG_ZONE_NORMAL;
+	window->enabled = true;
+}
+
+/**
+ * Disables the window comparator, the user handler is called again on every conversion.
+ *
+ * @param pin PinName related to AD channel
+ */
+void AnalogIn_disableWindow(PinName pin){
+	uint8_t channel = AnalogIn_getChannelNum(pin);
+
+	if(channel == AnalogIn_INVALID_CHANNEL){
+		return;
+	}
+
+	_window[channel].enabled = false;
+}
+
+/**
+ * Returns the zone of the last conversion evaluated by the window comparator.
+ *
+ * @param pin PinName related to AD channel
+ *
+ * @see AnalogInZone
+ */
+AnalogInZone AnalogIn_getZone(PinName pin){
+	uint8_t channel = AnalogIn_getChannelNum(pin);
+
+	if(channel == AnalogIn_INVALID_CHANNEL){
+		return ANALOG_ZONE_NORMAL;
+	}
+
+	return _window[channel].zone;
+}
+
+/**
+ * Auxiliary function that runs the window comparator of a channel.
+ *
+ * @return true if the value crossed into another zone.
+ */
+bool AnalogIn_updateZone(uint8_t channel, uint32_t value){
+	AnalogInWindow* window = &_window[channel];
+	AnalogInZone zone = window->zone;
+
+	switch(zone){
+	case ANALOG_ZONE_LOW:
+		if(value >= window->low + window->hysteresis){
+			zone = ANALOG_ZONE_NORMAL;
+		}
+		break;
+	case ANALOG_ZONE_HIGH:
+		if(value + window->hysteresis <= window->high){
+			zone = ANALOG_ZONE_NORMAL;
+		}
+		break;
+	default:
+		break;
+	}
+
+	if(value < window->low && zone != ANALOG_ZONE_LOW){
+		zone = ANALOG_ZONE_LOW;
+	}else if(value > window->high && zone != ANALOG_ZONE_HIGH){
+		zone = ANALOG_ZONE_HIGH;
+	}
+
+	if(zone == window->zone){
+		return false;
+	}
+
+	window->zone = zone;
+	return true;
+}
+
+/**
+ * Sets the linear calibration of the AD channel related to pin.
+ * The value returned by AnalogIn_readUnits is ((raw - offset) * gain) >> 16, computed only with 32 bit
+ * integer multiplies, so neither the floating point nor the 64 bit multiply library is needed (the
+ * LPC111X Cortex-M0 has no FPU and no long multiply). raw - offset is clamped to +/-(2^23 - 1), far beyond
+ * any ADC result; the result itself must fit in 32 bits.
+ *
+ * Example: 3.3V reference and 10 bits ADC to millivolts, gain = AnalogIn_Q16(3300.0 / 1024).
+ *
+ * @param pin PinName related to AD channel
+ * @param offset Raw counts read with zero input.
+ * @param gain Q16 fixed point gain (AnalogIn_Q16_ONE = 1.0), in units per count.
+ *
+ * @see AnalogIn_Q16
+ * @see AnalogIn_readUnits
+ */
+void AnalogIn_setCalibration(PinName pin, int32_t offset, int32_t gain){
+	uint8_t channel = AnalogIn_getChannelNum(pin);
+
+	if(channel == AnalogIn_INVALID_CHANNEL){
+		return;
+	}
+
+	_calibration[channel].offset = offset;
+	_calibration[channel].gain = gain;
+}
+
+/**
+ * Sets a piecewise-linear table applied after the linear calibration, for non linear sensors (thermistors, etc).
+ * The table points are equally spaced by 2^stepBits counts of the linear calibrated value: table[i] is the result
+ * for the input i << stepBits and the values between two points are interpolated without division.
+ * Inputs below the first point or beyond the last one are clamped.
+ *
+ * The table is not copied, it must stay allocated (it may be const in flash).
+ *
+ * The interpolation is done in 32 bits, so two neighbour points must differ by less than 2^(31 - stepBits);
+ * a table with a wider step is rejected and the channel is left without table.
+ *
+ * @param pin PinName related to AD channel
+ * @param table Engineering unit values of the points, or NULL to disable the table.
+ * @param tableSize Number of points in table (at least 2).
+ * @param stepBits log2 of the distance between two points, up to 30.
+ * @return true if the table is used, false if it was rejected or disabled.
+ *
+ * @see AnalogIn_setCalibration
+ */
+bool AnalogIn_setCalibrationTable(PinName pin, const int32_t* table, uint8_t tableSize, uint8_t stepBits){
+	uint8_t channel = AnalogIn_getChannelNum(pin);
+	AnalogInCalibration* calibration;
+	int64_t limit;
+	int64_t step;
+	uint8_t i;
+
+	if(channel == AnalogIn_INVALID_CHANNEL){
+		return false;
+	}
+
+	calibration = &_calibration[channel];
+
+	calibration->table = NULL;
+	if(table == NULL || tableSize < 2 || stepBits > 30){
+		return false;
+	}
+
+	/* Checked once here, so AnalogIn_toUnits needs no 64 bit arithmetic */
+	limit = (int64_t)0x1 << (31 - stepBits);
+	for(i = 0 ; i < tableSize - 1 ; i++){
+		step = (int64_t)table[i + 1] - table[i];
+		if(step >= limit || step <= -limit){
+			return false;
+		}
+	}
+
+	calibration->tableBits = stepBits;
+	calibration->tableSize = tableSize;
+	calibration->table = table;
+
+	return true;
+}
+
+/**
+ * Converts a raw value of the AD channel related to pin to engineering units, using its calibration.
+ * Useful for values taken from AnalogIn_readSamples or AnalogIn_readMany.
+ *
+ * @param pin PinName related to AD channel
+ * @param raw Value returned by the driver (decimated value if oversampling is enabled).
+ * @return the calibrated value.
+ */
+int32_t AnalogIn_toUnits(PinName pin, int32_t raw){
+	uint8_t channel = AnalogIn_getChannelNum(pin);
+	const AnalogInCalibration* calibration;
+	int32_t input;
+	int32_t value;
+	int32_t index;
+	int32_t fraction;
+
+	if(channel == AnalogIn_INVALID_CHANNEL){
+		return AnalogIn_INVALID_UNITS;
+	}
+
+	calibration = &_calibration[channel];
+
+	input = raw - calibration->offset;
+	if(input > ADC_MAX_GAIN_INPUT){
+		input = ADC_MAX_GAIN_INPUT;
+	}else if(input < -ADC_MAX_GAIN_INPUT){
+		input = -ADC_MAX_GAIN_INPUT;
+	}
+
+	/* (input * gain) >> 16 with 32 bit multiplies: integer part, then the fraction byte by byte.
+	 * Each partial product stays below 2^31 and the nested shifts round down as the single one would. */
+	value = (input * (calibration->gain >> 16)) +
+			(((input * ((calibration->gain >> 8) & 0xFF)) + ((input * (calibration->gain & 0xFF)) >> 8)) >> 8);
+
+	if(calibration->table == NULL){
+		return value;
+	}
+
+	if(value <= 0){
+		return calibration->table[0];
+	}
+
+	index = value >> calibration->tableBits;
+	if(index >= calibration->tableSize - 1){
+		return calibration->table[calibration->tableSize - 1];
+	}
+
+	fraction = value & ((0x1 << calibration->tableBits) - 1);
+
+	return calibration->table[index] +
+			(((calibration->table[index + 1] - calibration->table[index]) * fraction) >> calibration->tableBits);
+}
+
+/**
+ * Reads the AD channel related to pin (as AnalogIn_read) and returns it in engineering units.
+ *
+ * @param pin PinName related to AD channel
+ * @return the calibrated value, or AnalogIn_INVALID_UNITS on overrun.
+ *
+ * @see AnalogIn_setCalibration
+ * @see AnalogIn_setCalibrationTable
+ */
+int32_t AnalogIn_readUnits(PinName pin){
+	int32_t raw = AnalogIn_read(pin);
+
+	if(raw < 0){
+		return AnalogIn_INVALID_UNITS;
+	}
+
+	return AnalogIn_toUnits(pin, raw);
+}
+
+/**
+ * Sets a buffer where every conversion of the AD channel related to pin is queued by the interrupt handler.
+ * The buffer is a single producer/single consumer ring: the interrupt handler only writes the head and
+ * AnalogIn_readSamples only writes the tail, so no critical section is needed on either side.
+ * One slot is kept free to tell a full buffer from an empty one, so it holds up to bufferSize - 1 samples.
+ * When the buffer is full new samples are dropped and counted as overruns.
+ *
+ * @param pin PinName related to AD channel
+ * @param allocatedBuffer Buffer allocated by the user, or NULL to disable the queue.
+ * @param bufferSize Number of AnalogInSample entries in allocatedBuffer.
+ *
+ * @see AnalogIn_readSamples
+ * @see AnalogIn_getOverrunCount
+ */
+void AnalogIn_setSampleBuffer(PinName pin, AnalogInSample* allocatedBuffer, uint16_t bufferSize){
+	uint8_t channel = AnalogIn_getChannelNum(pin);
+	AnalogInSampleFifo* fifo;
+
+	if(channel == AnalogIn_INVALID_CHANNEL){
+		return;
+	}
+
+	fifo = &_fifo[channel];
+
+	fifo->buffer = NULL;
+	fifo->head = 0;
+	fifo->tail = 0;
+	fifo->overruns = 0;
+	fifo->size = bufferSize;
+	fifo->buffer = (bufferSize > 1) ? allocatedBuffer : NULL;
+}
+
+/**
+ * Copies up to maxSamples queued samples of the AD channel related to pin, oldest first.
+ *
+ * @param pin PinName related to AD channel
+ * @param samples Destination of the samples.
+ * @param maxSamples Size of samples.
+ * @return the number of samples copied.
+ */
+uint16_t AnalogIn_readSamples(PinName pin, AnalogInSample* samples, uint16_t maxSamples){
+	uint8_t channel = AnalogIn_getChannelNum(pin);
+	AnalogInSampleFifo* fifo;
+	uint16_t head;
+	uint16_t tail;
+	uint16_t count = 0;
+
+	if(channel == AnalogIn_INVALID_CHANNEL){
+		return 0;
+	}
+
+	fifo = &_fifo[channel];
+	head = fifo->head;
+	tail = fifo->tail;
+
+	if(fifo->buffer == NULL){
+		return 0;
+	}
+
+	while(tail != head && count < maxSamples){
+		samples[count++] = fifo->buffer[tail];
+		if(++tail == fifo->size){
+			tail = 0;
+		}
+	}
+
+	fifo->tail = tail;
+	return count;
+}
+
+/**
+ * Returns how many samples are queued on the AD channel related to pin.
+ *
+ * @param pin PinName related to AD channel
+ */
+uint16_t AnalogIn_availableSamples(PinName pin){
+	uint8_t channel = AnalogIn_getChannelNum(pin);
+	AnalogInSampleFifo* fifo;
+	uint16_t head;
+	uint16_t tail;
+
+	if(channel == AnalogIn_INVALID_CHANNEL){
+		return 0;
+	}
+
+	fifo = &_fifo[channel];
+	head = fifo->head;
+	tail = fifo->tail;
+
+	if(fifo->buffer == NULL){
+		return 0;
+	}
+
+	return (head >= tail) ? (head - tail) : (fifo->size - tail + head);
+}
+
+/**
+ * Returns how many samples of the AD channel related to pin were lost, either because the sample buffer
+ * was full or because the ADC overwrote a result that was not read (hardware overrun).
+ *
+ * @param pin PinName related to AD channel
+ */
+uint32_t AnalogIn_getOverrunCount(PinName pin){
+	uint8_t channel = AnalogIn_getChannelNum(pin);
+
+	if(channel == AnalogIn_INVALID_CHANNEL){
+		return 0;
+	}
+
+	return _fifo[channel].overruns;
+}
+
+/**
+ * Sets the hardware timer whose counter (TC) is used as timestamp of the queued samples.
+ * On LPC13xx/LPC111X the timer must be configured and enabled by the user as a free-running counter.
+ * On LPC17xx timerNum 0..3 selects TIM0..TIM3; a timer that is not counting yet is started
+ * as a free-running microsecond counter, since there is no HardwareTimer driver for it.
+ * Until this function is called every sample is stamped 0.
+ *
+ * @param timerNum Hardware timer
+ *
+ * @see AnalogIn_setSampleBuffer
+ * @see HardwareTimerNum
+ */
+void AnalogIn_setTimestampTimer(HardwareTimerNum timerNum){
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+	_timestampCounter = &(HardwareTimer_getLPC_TMR(timerNum)->TC);
+#elif defined (TARGET_LPC17XX)
+	static LPC_TIM_TypeDef* const timers[4] = {LPC_TIM0, LPC_TIM1, LPC_TIM2, LPC_TIM3};
+	static const uint8_t powerBit[4] = {1, 2, 22, 23};
+	static const uint8_t pclkDivider[4] = {4, 1, 2, 8};
+	LPC_TIM_TypeDef* timer = timers[timerNum];
+	uint32_t pclkSel = (timerNum < 2) ? (LPC_SC->PCLKSEL0 >> (2 + (timerNum * 2)))
+	                                  : (LPC_SC->PCLKSEL1 >> (12 + ((timerNum - 2) * 2)));
+
+	BITBAND_SET_BIT(LPC_SC->PCONP, powerBit[timerNum]);
+	if(!(timer->TCR & 0x01)){
+		timer->TCR = 0x02;		/* reset timer */
+		timer->PR  = (SystemCoreClock / pclkDivider[pclkSel & 0x3] / 1000000) - 1;
+		timer->MCR = 0x00;
+		timer->TCR = 0x01;		/* start timer */
+	}
+	_timestampCounter = &timer->TC;
+#endif
+}
+
+/**
+ * Auxiliary function that queues a sample on a channel, called only from AnalogIn_default_handler.
+ */
+void AnalogIn_pushSample(uint8_t channel, uint32_t timestamp, uint32_t value){
+	AnalogInSampleFifo* fifo = &_fifo[channel];
+	uint16_t head = fifo->head;
+	uint16_t next = head + 1;
+
+	if(fifo->buffer == NULL){
+		return;
+	}
+
+	if(next == fifo->size){
+		next = 0;
+	}
+
+	if(next == fifo->tail){
+		fifo->overruns++;
+		return;
+	}
+
+	fifo->buffer[head].timestamp = timestamp;
+	fifo->buffer[head].value = value;
+	fifo->head = next;
+}
 
 /**
  * Sets the clock of AD peripheral.
@@ -179,10 +799,12 @@ void AnalogIn_setClock(uint32_t clock){
 
 #elif defined (TARGET_LPC17XX)
 
+	uint32_t pclkdiv, pclk;
+
 	/* By default, the PCLKSELx value is zero, thus, the PCLK for
 		  all the peripherals is 1/4 of the SystemFrequency. */
-	/* Bit 6~7 is for UART0 */
-	pclkdiv = (LPC_SC->PCLKSEL0 >> 6) & 0x03;
+	/* Bit 24~25 is for ADC */
+	pclkdiv = (LPC_SC->PCLKSEL0 >> 24) & 0x03;
 	switch ( pclkdiv )
 	{
 	case 0x00:
@@ -200,20 +822,17 @@ void AnalogIn_setClock(uint32_t clock){
 		break;
 	}
 
-	LPC_ADC->ADCR = ( 0x01 << 0 ) | 	/* SEL=1,select channel 0 on ADC0 */
-			( ( pclk  / _clock - 1 ) << 8 ) |  /* CLKDIV = Fpclk / _clock - 1 */
-			( 0 << 16 ) | 		/* BURST = 0, no BURST, software controlled */
-			( 0 << 17 ) |  		/* CLKS = 0, 11 clocks/10 bits */
-			( 1 << 21 ) |  		/* PDN = 1, normal operation */
-			( 0 << 24 ) |  		/* START = 0 A/D conversion stops */
-			( 0 << 27 );		/* EDGE = 0 (CAP/MAT singal falling,trigger A/D conversion) */
+	/* The ADC clock must not exceed 13MHz, so the division is rounded up */
+	LPC_ADC->ADCR &= 0xFFFF00FF;
+	LPC_ADC->ADCR |= (((((pclk + _clock - 1) / _clock) - 1) & 0xFF) << 8) |	/* CLKDIV = Fpclk / _clock - 1 */
+			( 1 << 21 );		/* PDN = 1, normal operation */
 
 #endif
 }
 
 /**
  * Enables conversion of the AD channel related to pin.
- * Note: this function not run the conversion, only enables the channel to be converted.
+ * Note: this function not run the conversion, only includes the channel in the conversions queued by AnalogIn_startConversion.
  *
  * @param pin AD channel.
  *
@@ -222,16 +841,17 @@ void AnalogIn_setClock(uint32_t clock){
  */
 void AnalogIn_enableConversion(PinName pin){
 	uint8_t channel = AnalogIn_getChannelNum(pin);
-#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
-	LPC_ADC->CR |= (0x1 << channel);
-#elif defined (TARGET_LPC17XX)
 
-#endif
+	if(channel == AnalogIn_INVALID_CHANNEL){
+		return;
+	}
+
+	_scanChannels |= (0x1 << channel);
 }
 
 /**
  * Disables conversion of the AD channel related to pin.
- * Note: this function not stop the conversion, only disables the channel to be converted.
+ * Note: this function not stop the conversion, only removes the channel from the conversions queued by AnalogIn_startConversion.
  *
  * @param pin AD channel.
  *
@@ -240,34 +860,146 @@ void AnalogIn_enableConversion(PinName pin){
  */
 void AnalogIn_disableConversion(PinName pin){
 	uint8_t channel = AnalogIn_getChannelNum(pin);
-#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
-	LPC_ADC->CR &= ~(0x1 << channel);
-#elif defined (TARGET_LPC17XX)
 
-#endif
+	if(channel == AnalogIn_INVALID_CHANNEL){
+		return;
+	}
+
+	_scanChannels &= ~(0x1 << channel);
 }
 
 /**
  * Starts the conversion of enabled AD channels.
+ * One conversion of each enabled interrupt channel is queued; the channels are converted one at a time
+ * in background and each result is delivered by the interrupt handler.
  */
 void AnalogIn_startConversion(){
+	AnalogIn_acquire(0);
+	_pendingChannels |= (_scanChannels & _irqChannels);
+	AnalogIn_release();
+}
+
+
+/**
+ * Stops the all conversions (all channels).
+ * The queued background conversions are discarded.
+ */
+void AnalogIn_stopConversion(){
+	AnalogIn_acquire(0);
+	_pendingChannels = 0;
+	_busyChannel = ADC_NO_CHANNEL;
+	/* Called from an interrupt during a foreground read, the converter is not ours to stop */
+	if(_foregroundDepth == 1){
 #if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
-	LPC_ADC->CR |= (0x1 << 24);
+		LPC_ADC->CR &= 0xF8FFFFFF;	/* stop ADC now */
 #elif defined (TARGET_LPC17XX)
-
+		LPC_ADC->ADCR &= 0xF8FFFFFF;	/* stop ADC now */
 #endif
+	}
+	AnalogIn_release();
 }
 
+/**
+ * Auxiliary function that starts the next queued background conversion when the converter is idle.
+ * Channels are served in round-robin, so an oversampled channel does not starve the others.
+ * While a foreground access owns the converter the channels only stay queued.
+ * Must be called with the ADC interrupt masked or from the ADC interrupt handler.
+ */
+void AnalogIn_convertNext(){
+
+	uint8_t channel = _lastChannel;
+	uint8_t i;
+
+	if(_foregroundDepth != 0 || _busyChannel != ADC_NO_CHANNEL || _pendingChannels == 0){
+		return;
+	}
+
+#if defined (TARGET_LPC17XX)
+	if(_dmaRunning){
+		return;
+	}
+#endif
+
+	for(i = 0 ; i < ADC_CHANNELS ; i++){
+		channel = (channel + 1) & (ADC_CHANNELS - 1);
+		if(_pendingChannels & (0x1 << channel)){
+			break;
+		}
+	}
+
+	_pendingChannels &= ~(0x1 << channel);
+	_busyChannel = channel;
+	_lastChannel = channel;
+
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+	LPC_ADC->CR &= 0xF8FEFF00;						/* No START, no BURST, no channel */
+	LPC_ADC->CR |= (0x1 << 24) | (0x1 << channel);	/* switch channel,start A/D convert */
+#elif defined (TARGET_LPC17XX)
+	LPC_ADC->ADCR &= 0xF8FEFF00;					/* No START, no BURST, no channel */
+	LPC_ADC->ADCR |= (0x1 << 24) | (0x1 << channel);	/* switch channel,start A/D convert */
+#endif
+}
 
 /**
- * Stops the all conversions (all channels).
+ * Auxiliary function that takes the converter for a foreground (blocking) access.
+ * The ADC interrupt is masked and the background conversion already running, if any, is allowed to finish;
+ * its result stays in its data register for the interrupt handler. If that channel is also going to be
+ * converted in foreground, the background conversion is queued again instead.
+ * The calls nest: an interrupt handler may acquire the converter during a foreground read, and only the
+ * outermost AnalogIn_release hands it back to the background queue.
+ *
+ * @param urgentChannels Channels that will be converted in foreground.
+ *
+ * @see AnalogIn_release
  */
-void AnalogIn_stopConversion(){
+void AnalogIn_acquire(uint32_t urgentChannels){
+
+	uint8_t busy;
+
+	/* Owner first, so an interrupt arriving before the mask does not start a background conversion */
+	_foregroundDepth++;
+	NVIC_DisableIRQ(ADC_IRQn);
+
+	busy = _busyChannel;
+	if(busy == ADC_NO_CHANNEL){
+		return;
+	}
+
 #if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
-	LPC_ADC->CR &= 0xF8FFFFFF;	/* stop ADC now */
+	while(!(LPC_ADC->STAT & (0x1 << busy)));		/* wait until end of A/D convert */
 #elif defined (TARGET_LPC17XX)
-	LPC_ADC->ADCR &= 0xF8FFFFFF;	/* stop ADC now */
+	while(!(LPC_ADC->ADSTAT & (0x1 << busy)));	/* wait until end of A/D convert */
 #endif
+
+	if(urgentChannels & (0x1 << busy)){
+		_pendingChannels |= (0x1 << busy);
+		_busyChannel = ADC_NO_CHANNEL;
+	}
+}
+
+/**
+ * Auxiliary function that gives the converter back to the background queue.
+ * A nested release only drops its ownership; the converter and the ADC interrupt stay with the outer owner.
+ *
+ * @see AnalogIn_acquire
+ */
+void AnalogIn_release(){
+
+	if(--_foregroundDepth != 0){
+		return;
+	}
+
+	AnalogIn_convertNext();
+
+#if defined (TARGET_LPC17XX)
+	if(_dmaRunning){
+		return;
+	}
+#endif
+
+	if(_irqChannels != 0){
+		NVIC_EnableIRQ(ADC_IRQn);
+	}
 }
 
 
@@ -279,126 +1011,334 @@ void AnalogIn_stopConversion(){
  * @return the conversation result of specified channel.
  *
  * @see AnalogIn_Init
+ * @see AnalogIn_setOversampling
  * Notes:
- * 	If this peripheral was initialized using interruption then the result is the last conversation done in this channel, because this is managed by interruption;
- * 	And if this peripheral was initialized using no interruption, then the channel is instantly read and the result value is returned only when the conversation finish.
+ * 	If this channel was initialized using interruption then the result is the last conversation done in this channel, because this is managed by interruption;
+ * 	And if this channel was initialized using no interruption, then the channel is instantly read and the result value is returned only when the conversation finish.
+ * 	If oversampling is enabled on this channel, the result is the decimated value.
  *
  *
  */
 int32_t AnalogIn_read(PinName pin){
 
-	int32_t regVal, data;
 	uint8_t channel = AnalogIn_getChannelNum(pin);
 
+	if(channel == AnalogIn_INVALID_CHANNEL){
+		return ( -1 );
+	}
+
 	//If IRQ is not to be used then the ADC value is will be get by polling
-	if(!_useIRQ){
+	if(!(_irqChannels & (0x1 << channel))){
+
+		int32_t data;
+		uint32_t result;
+
+		if(_decimator[channel].extraBits == 0){
+			return AnalogIn_readRaw(pin);
+		}
+
+		do{
+			data = AnalogIn_readRaw(pin);
+			if(data < 0){
+				return ( -1 );
+			}
+		}while(!AnalogIn_decimate(channel, data, &result));
+
+		return ( result );
+	}
+
+	//ADC is using IRQ and the last converted data is stored in _readedValue;
+	return _readedValue[channel];
+}
+
+/**
+ * Reads several AD channels with a single burst scan.
+ * All channels are selected at once, the ADC converts them back to back in hardware and each result is
+ * collected from its channel data register, so the setup cost is paid once for the whole set.
+ * The ADC interrupts are masked while the scan runs and the background queue continues afterwards.
+ *
+ * @param pins PinNames related to AD channels.
+ * @param count Number of pins.
+ * @param values Conversion results, in the same order of pins; -1 for a non-analog pin or a channel that did not complete.
+ *
+ * Note: the results are raw conversions, oversampling and calibration are not applied.
+ *
+ * @see AnalogIn_read
+ */
+void AnalogIn_readMany(const PinName* pins, uint8_t count, int32_t* values){
+
+	uint32_t selMask = 0;
+	uint32_t doneMask = 0;
+	uint32_t intEnable;
+	uint32_t regVal;
+	uint32_t timeout = 0x000FFFFF;
+	uint8_t channel;
+	uint8_t i;
+
+	for(i = 0 ; i < count ; i++){
+		channel = AnalogIn_getChannelNum(pins[i]);
+		if(channel != AnalogIn_INVALID_CHANNEL){
+			selMask |= (0x1 << channel);
+		}
+	}
+
+	if(selMask == 0){
+		for(i = 0 ; i < count ; i++){
+			values[i] = -1;
+		}
+		return;
+	}
+
+	AnalogIn_acquire(selMask);
 
 #if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
-		LPC_ADC->CR &= 0xFFFFFF00;
-		LPC_ADC->CR |= (1 << 24) | (1 << channel);
-		/* switch channel,start A/D convert */
+	intEnable = LPC_ADC->INTEN;
+	LPC_ADC->INTEN = 0x00;
+
+	for(channel = 0 ; channel < ADC_CHANNELS ; channel++){
+		if(selMask & (0x1 << channel)){
+			regVal = LPC_ADC->DR[channel];		/* Reading clears stale DONE flags */
+		}
+	}
+
+	LPC_ADC->CR &= 0xF8FEFF00;					/* No START, no BURST, no channel */
+	LPC_ADC->CR |= (0x1 << 16) | selMask;		/* BURST scan of every selected channel */
+
+	while((doneMask != selMask) && (--timeout != 0)){
+		doneMask |= (LPC_ADC->STAT & selMask);
+	}
+
+	BITBAND_CLEAR_BIT(LPC_ADC->CR, 16);			/* Stop after the current scan */
+
+	for(i = 0 ; i < count ; i++){
+		channel = AnalogIn_getChannelNum(pins[i]);
+		if(channel == AnalogIn_INVALID_CHANNEL){
+			values[i] = -1;
+			continue;
+		}
+		regVal = LPC_ADC->DR[channel];
+		values[i] = (doneMask & (0x1 << channel)) ? (int32_t)(( regVal >> 6 ) & 0x3FF) : -1;
+	}
+
+	LPC_ADC->INTEN = intEnable;
+
 #elif defined (TARGET_LPC17XX)
-		LPC_ADC->ADCR &= 0xFFFFFF00;
-		LPC_ADC->ADCR |= (1 << 24) | (1 << channel);
-		/* switch channel,start A/D convert */
-#endif
+	intEnable = LPC_ADC->ADINTEN;
+	LPC_ADC->ADINTEN = 0x00;
 
-		while ( 1 )			/* wait until end of A/D convert */
-		{
-			regVal = AnalogIn_readLPC_ADC_Value(pin);
-			/* read result of A/D conversion */
-			if ( regVal & AnalogIn_CHANNEL_DONE_MASK )
-			{
-				break;
-			}
+	for(channel = 0 ; channel < ADC_CHANNELS ; channel++){
+		if(selMask & (0x1 << channel)){
+			regVal = AnalogIn_readLPC_ADC_ADDRn(channel);	/* Reading clears stale DONE flags */
 		}
+	}
+
+	LPC_ADC->ADCR &= 0xF8FEFF00;				/* No START, no BURST, no channel */
+	LPC_ADC->ADCR |= (0x1 << 16) | selMask;		/* BURST scan of every selected channel */
 
-		AnalogIn_stopConversion();
+	while((doneMask != selMask) && (--timeout != 0)){
+		doneMask |= (LPC_ADC->ADSTAT & selMask);
+	}
+
+	BITBAND_CLEAR_BIT(LPC_ADC->ADCR, 16);			/* Stop after the current scan */
 
-		if ( regVal & AnalogIn_CHANNEL_OVERRUN_MASK )	/* save data when it's not overrun, otherwise, return -1 */
+	for(i = 0 ; i < count ; i++){
+		channel = AnalogIn_getChannelNum(pins[i]);
+		if(channel == AnalogIn_INVALID_CHANNEL){
+			values[i] = -1;
+			continue;
+		}
+		regVal = AnalogIn_readLPC_ADC_ADDRn(channel);
+		values[i] = (doneMask & (0x1 << channel)) ? (int32_t)(( regVal >> 4 ) & 0xFFF) : -1;
+	}
+
+	LPC_ADC->ADINTEN = intEnable;
+#endif
+
+	AnalogIn_release();
+}
+
+/**
+ * Auxiliary function that runs one blocking conversion on the AD channel specified by pin.
+ *
+ * @param pin PinName related to AD channel.
+ * @return the conversion result, or -1 on overrun.
+ */
+int32_t AnalogIn_readRaw(PinName pin){
+
+	int32_t regVal, data;
+	uint8_t channel = AnalogIn_getChannelNum(pin);
+
+	if(channel == AnalogIn_INVALID_CHANNEL){
+		return ( -1 );
+	}
+
+	AnalogIn_acquire(0x1 << channel);
+
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+	LPC_ADC->CR &= 0xF8FEFF00;
+	LPC_ADC->CR |= (1 << 24) | (1 << channel);
+	/* switch channel,start A/D convert */
+#elif defined (TARGET_LPC17XX)
+	LPC_ADC->ADCR &= 0xF8FEFF00;
+	LPC_ADC->ADCR |= (1 << 24) | (1 << channel);
+	/* switch channel,start A/D convert */
+#endif
+
+	while ( 1 )			/* wait until end of A/D convert */
+	{
+		regVal = AnalogIn_readLPC_ADC_Value(pin);
+		/* read result of A/D conversion */
+		if ( regVal & AnalogIn_CHANNEL_DONE_MASK )
 		{
-			return ( -1 );
+			break;
 		}
+	}
 
 #if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
-		data = ( regVal >> 6 ) & 0x3FF;	// data value of ADC is in 15:6 bits (10 bits precision)
+	LPC_ADC->CR &= 0xF8FFFFFF;	/* stop ADC now */
 #elif defined (TARGET_LPC17XX)
-		data = ( regVal >> 4 ) & 0xFFF; // data value of ADC is in 15:4 bits (12 bits precision)
+	LPC_ADC->ADCR &= 0xF8FFFFFF;	/* stop ADC now */
 #endif
 
-		return ( data );	/* return A/D conversion value */
+	AnalogIn_release();
+
+	if ( regVal & AnalogIn_CHANNEL_OVERRUN_MASK )	/* save data when it's not overrun, otherwise, return -1 */
+	{
+		return ( -1 );
 	}
 
-	//ADC is using IRQ and the last converted data is stored in _readedValue;
-	return _readedValue[channel];
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+	data = ( regVal >> 6 ) & 0x3FF;	// data value of ADC is in 15:6 bits (10 bits precision)
+#elif defined (TARGET_LPC17XX)
+	data = ( regVal >> 4 ) & 0xFFF; // data value of ADC is in 15:4 bits (12 bits precision)
+#endif
+
+	return ( data );	/* return A/D conversion value */
+}
+
+/**
+ * Auxiliary function that feeds one conversion into the decimation filter of a channel.
+ *
+ * The boxcar filter sums 4^n conversions and shifts the sum right by n.
+ * The CIC filter has two integrators running at the conversion rate and two combs running at the output rate;
+ * its gain is (4^n)^2, so the output is shifted right by 3n. The integrators are allowed to wrap around,
+ * the comb differences are still exact in modulo 2^32 arithmetic.
+ *
+ * @param channel AD channel.
+ * @param sample Raw conversion result.
+ * @param result Where the decimated value is stored when available.
+ * @return true if a new decimated value was stored in result.
+ */
+bool AnalogIn_decimate(uint8_t channel, uint32_t sample, uint32_t* result){
+
+	AnalogInDecimator* decimator = &_decimator[channel];
+	uint8_t n = decimator->extraBits;
+	uint32_t output, diff;
+
+	if(decimator->filter == ANALOG_FILTER_CIC){
+		decimator->integrator[0] += sample;
+		decimator->integrator[1] += decimator->integrator[0];
+	}else{
+		decimator->integrator[0] += sample;
+	}
+
+	if(++(decimator->count) < (1 << (2 * n))){
+		return false;
+	}
+	decimator->count = 0;
+
+	if(decimator->filter == ANALOG_FILTER_CIC){
+		diff = decimator->integrator[1] - decimator->comb[0];
+		decimator->comb[0] = decimator->integrator[1];
+		output = diff - decimator->comb[1];
+		decimator->comb[1] = diff;
+		output >>= (3 * n);
+
+		if(decimator->warmup){
+			decimator->warmup--;
+			return false;
+		}
+	}else{
+		output = decimator->integrator[0] >> n;
+		decimator->integrator[0] = 0;
+	}
+
+	*result = output;
+	return true;
 }
 
 /**
  * Handler to process interruption of end of conversion.
- * This function is call always a AD channel ends some conversion.
+ * This function is call always a background AD conversion ends, it delivers the result and starts the next queued conversion.
  */
 void AnalogIn_default_handler()
 {
 	uint32_t regVal;
 	uint32_t statReg;
-	uint8_t channel;
-	uint8_t flagChannel = 0;
-	uint32_t result_GDR_Reg = 0;
-
-	AnalogIn_stopConversion();
-	LPC_ADC->INTEN &= ~(0x1 << 8);	/* Disable Global ADC interruption */
+	uint8_t channel = _busyChannel;
+	uint32_t timestamp = (_timestampCounter != NULL) ? *_timestampCounter : 0;
 
 #if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
-	statReg = LPC_ADC->STAT;		/* Read ADC will clear the interrupt */
+	statReg = LPC_ADC->STAT;
 #elif defined (TARGET_LPC17XX)
-	statReg = LPC_ADC->ADSTAT;		/* Read ADC will clear the interrupt */
+	statReg = LPC_ADC->ADSTAT;
 #endif
 
-	regVal = LPC_ADC->GDR;
-	channel = (regVal >> 24) & 0x07;	/* Get channel referred to last conversion */
-	result_GDR_Reg = (regVal >> 6) & 0x3FF;		/* Get the result value from ADC conversion */
-
-	flagChannel = (statReg & (0x101 << channel));
+	/* Spurious interrupt: a foreground read already collected the result */
+	if(channel == ADC_NO_CHANNEL || !(statReg & (0x1 << channel))){
+		return;
+	}
 
-	if(_enabledADC[channel] && flagChannel){
-
-		if ( statReg & (0x100 << channel) )	/* check OVERRUN error first */
-		{
-			/* if overrun, just read ADDR to clear */
-			/* regVal variable has been reused. */
+	_busyChannel = ADC_NO_CHANNEL;
 
+	/* Reading the data register clears the DONE flag and the interrupt */
 #if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
-			regVal = LPC_ADC->DR[channel];
+	LPC_ADC->CR &= 0xF8FFFFFF;	/* stop ADC now */
+	regVal = LPC_ADC->DR[channel];
 #elif defined (TARGET_LPC17XX)
-			regVal = AnalogIn_readLPC_ADC_ADDRn(channel);
+	LPC_ADC->ADCR &= 0xF8FFFFFF;	/* stop ADC now */
+	regVal = AnalogIn_readLPC_ADC_ADDRn(channel);
 #endif
 
+	if(_enabledADC[channel]){
+
+		if ( statReg & (0x100 << channel) )	/* check OVERRUN error first */
+		{
+			_fifo[channel].overruns++;
 		}
-		else if ( statReg & AnalogIn_STAT_ADINT_MASK )
+		else
 		{
-			if ( statReg & (0x1 << channel) )
-			{
 
 #if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
-				//_readedValue[channel] = result_GDR_Reg;
-				_readedValue[channel] = ( LPC_ADC->DR[channel] >> 6 ) & 0x3FF;
+			regVal = ( regVal >> 6 ) & 0x3FF;
 #elif defined (TARGET_LPC17XX)
-				_readedValue[channel] = ( AnalogIn_readLPC_ADC_ADDRn(channel) >> 4 ) & 0xFFF;
+			regVal = ( regVal >> 4 ) & 0xFFF;
 #endif
 
-				uint32_t pinIndex = GET_PIN_INDEX(AnalogIn_getPinName(channel));
-				if(_userHandlerPtr[pinIndex] != NULL){
-					(_userHandlerPtr[pinIndex])();
+			if(_decimator[channel].extraBits != 0 && !AnalogIn_decimate(channel, regVal, &regVal)){
+				/* Output period not finished yet, queue the next conversion without bothering the user */
+				_pendingChannels |= (0x1 << channel);
+			}else{
+
+				_readedValue[channel] = regVal;
+				AnalogIn_pushSample(channel, timestamp, regVal);
+
+				/* With the window comparator enabled the user is called only on zone crossings */
+				if(!_window[channel].enabled || AnalogIn_updateZone(channel, regVal)){
+					PinName pin = AnalogIn_getPinName(channel);
+					uint32_t pinIndex = GET_PIN_INDEX(pin);
+					if(_userHandlerPtr[pinIndex] != NULL){
+						(_userHandlerPtr[pinIndex])();
+					}
+					ContextHandler_call(&_userContextHandler[pinIndex], pin, regVal);
 				}
 			}
 
-		}// if ( ADINT )
+		}
 
 	}// if enabled ADC
 
-	LPC_ADC->INTEN |= (1 << 8); 	/* Enable Global ADC interruption */
-
-	//AnalogIn_startConversion();
+	AnalogIn_convertNext();
 }
 
 
@@ -422,81 +1362,39 @@ uint32_t AnalogIn_readLPC_ADC_Value(PinName pin){
  * @return PinName related to channel.
  */
 PinName AnalogIn_getPinName(uint8_t channel){
-
-	PinName pin = AD0;
-
-	switch(channel){
-	case 0: pin = AD0;	break;
-	case 1: pin = AD1;	break;
-	case 2: pin = AD2; 	break;
-	case 3:	pin = AD3;	break;
-	case 4: pin = AD4;	break;
-	case 5: pin = AD5;	break;
-	case 6: pin = AD6;	break;
-	case 7: pin = AD7;	break;
-	default:
-		break;
-	}
-
-	return pin;
+	return _pinOfChannel[channel & (ADC_CHANNELS - 1)];
 }
 
 /**
  * Return the correspondent AD channel of PinName.
  *
  * @param pin PinName related to channel.
- * @return AD channel.
+ * @return AD channel, or AnalogIn_INVALID_CHANNEL if the pin has no Analog-to-Digital function.
  */
 uint8_t AnalogIn_getChannelNum(PinName pin){
 
-	uint32_t channel = 0;
-
-	switch(pin){
-	case AD0:	channel = 0;	break;
-	case AD1:	channel = 1;	break;
-	case AD2:	channel = 2;	break;
-	case AD3:	channel = 3;	break;
-	case AD4:	channel = 4;	break;
-	case AD5:	channel = 5;	break;
-	case AD6:	channel = 6;	break;
-	case AD7:	channel = 7;	break;
-	default:
-		//error("The pin P%1d_%2d have not a Analog-to-Digital function",_portNum,_mask);
-		break;
+	uint8_t entry;
+
+	if(!IS_VALID_PIN(pin)){
+		return AnalogIn_INVALID_CHANNEL;
 	}
 
-	return channel;
-}
+	entry = _channelOfPin[GET_PIN_INDEX(pin)];
+	if(entry == 0){
+		return AnalogIn_INVALID_CHANNEL;
+	}
 
+	return (entry - 1);
+}
 
 #if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
 /**
  * Auxiliary function to return a pointer to address memory of IOCON pin related to PinName.
+ * Note: AD4 is the SWDIO pin (P1_3), using it as analog input disables the debugger.
  */
 volatile uint32_t* AnalogIn_getLPC_IOCON_PIO(PinName pin){
-
-	uint8_t channel = AnalogIn_getChannelNum(pin);
-
-	volatile uint32_t* lpc_iocon_pio[8] = {
-			&(LPC_IOCON->R_PIO0_11),	/* ADC IN0 */
-			&(LPC_IOCON->R_PIO1_0), 	/* ADC IN1 */
-			&(LPC_IOCON->R_PIO1_1),		/* ADC IN2 */
-			&(LPC_IOCON->R_PIO1_2),		/* ADC IN3 */
-			&(LPC_IOCON->SWDIO_PIO1_3),	/* ADC IN4 */
-			&(LPC_IOCON->PIO1_4),		/* ADC IN5 */
-			&(LPC_IOCON->PIO1_10),		/* ADC IN6 */
-			&(LPC_IOCON->PIO1_11)		/* ADC IN7 */
-	};
-
-#ifndef __SWD_DISABLED
-	if(channel == 4){
-		//error("You are using pin P1_3 (AD4) for Analog-to-Digital function but the flag __SWD_DISABLED is not set");
-	}
-#endif
-
-	return lpc_iocon_pio[channel];
+	return Digital_getIOConfigRegister(pin);
 }
-
 #endif // TARGET_LPC111X or TARGET_LPC13XX
 
 
@@ -509,21 +1407,161 @@ volatile uint32_t* AnalogIn_getLPC_IOCON_PIO(PinName pin){
  */
 uint32_t AnalogIn_readLPC_ADC_ADDRn(uint8_t channel){
 
-	uint32_t regVal = 0;
-	uint32_t lpc_adc_addr[8] = {
-			&(LPC_ADC->ADDR0),
-			&(LPC_ADC->ADDR1),
-			&(LPC_ADC->ADDR2),
-			&(LPC_ADC->ADDR3),
-			&(LPC_ADC->ADDR4),
-			&(LPC_ADC->ADDR5),
-			&(LPC_ADC->ADDR6),
-			&(LPC_ADC->ADDR7)};
+	/* ADDR0 to ADDR7 are contiguous */
+	return (&(LPC_ADC->ADDR0))[channel];
+
+}
+
+#endif // TARGET_LPC17XX
+
+
+#if defined (TARGET_LPC17XX)
+/**
+ * Starts a continuous burst acquisition of AD channels with the results moved to memory by the GPDMA.
+ *
+ * The ADC runs in BURST mode over every selected channel and each conversion raises a DMA request,
+ * so no CPU time is spent per sample. The buffer is split in two blocks of blockSize words linked to each other,
+ * the DMA fills one block while the user processes the other one, and blockHandler is called once per filled block.
+ * Each word is stored in ADGDR format, use AnalogIn_DMA_GET_CHANNEL and AnalogIn_DMA_GET_VALUE to decode it.
+ *
+ * For 200 kS/s set the ADC clock to 13MHz with AnalogIn_setClock before calling this function.
+ * The background conversions of interrupt channels are suspended until AnalogIn_stopDMA.
+ *
+ * @param pins PinNames related to AD channels, every pin must be already initialized with AnalogIn_Init.
+ * @param count Number of pins.
+ * @param allocatedBuffer Buffer allocated by the user with (2 * blockSize) words.
+ * @param blockSize Number of conversions per block, up to AnalogIn_DMA_MAX_BLOCK_SIZE.
+ * @param blockHandler User function called, in interrupt context, when a block is full.
+ *
+ * @see AnalogIn_getDMABlock
+ * @see AnalogIn_stopDMA
+ */
+void AnalogIn_startDMA(const PinName* pins, uint8_t count, uint32_t* allocatedBuffer, uint16_t blockSize, FunctionPointer blockHandler){
+
+	LPC_GPDMACH_TypeDef* dmaChannel = LPC_GPDMACH0;
+	uint32_t selMask = 0;
+	uint32_t control;
+	uint8_t channel;
+	uint8_t i;
+
+	if(blockSize > AnalogIn_DMA_MAX_BLOCK_SIZE){
+		blockSize = AnalogIn_DMA_MAX_BLOCK_SIZE;
+	}
+
+	for(i = 0 ; i < count ; i++){
+		channel = AnalogIn_getChannelNum(pins[i]);
+		if(channel != AnalogIn_INVALID_CHANNEL){
+			selMask |= (0x1 << channel);
+		}
+	}
+
+	if(selMask == 0){
+		return;
+	}
+
+	AnalogIn_stopDMA();
+
+	/* Let the running background conversion finish, the queue is resumed by AnalogIn_stopDMA */
+	AnalogIn_acquire(0);
+	_dmaRunning = true;
+
+	_dmaBlock[0] = allocatedBuffer;
+	_dmaBlock[1] = allocatedBuffer + blockSize;
+	_dmaCompletedBlock = 0;
+	_dmaBlockHandler = blockHandler;
+
+	/* Enable CLOCK into GPDMA controller */
+	BITBAND_SET_BIT(LPC_SC->PCONP, 29);
+	LPC_GPDMA->DMACConfig = 0x01;				/* Enable GPDMA, little endian */
+	LPC_GPDMA->DMACIntTCClear = (0x1 << AnalogIn_DMA_CHANNEL);
+	LPC_GPDMA->DMACIntErrClr = (0x1 << AnalogIn_DMA_CHANNEL);
+
+	control = (blockSize & 0xFFF) |	/* TransferSize */
+			( 0 << 12 ) |			/* SBSize = 1 */
+			( 0 << 15 ) |			/* DBSize = 1 */
+			( 2 << 18 ) |			/* SWidth = 32 bits */
+			( 2 << 21 ) |			/* DWidth = 32 bits */
+			( 0 << 26 ) |			/* Source is not incremented */
+			( 1 << 27 ) |			/* Destination is incremented */
+			( 1u << 31 );			/* Terminal count interrupt */
+
+	for(i = 0 ; i < 2 ; i++){
+		_dmaLLI[i].srcAddr = (uint32_t) &(LPC_ADC->ADGDR);
+		_dmaLLI[i].destAddr = (uint32_t) _dmaBlock[i];
+		_dmaLLI[i].nextLLI = (uint32_t) &_dmaLLI[1 - i];
+		_dmaLLI[i].control = control;
+	}
+
+	dmaChannel->DMACCSrcAddr = _dmaLLI[0].srcAddr;
+	dmaChannel->DMACCDestAddr = _dmaLLI[0].destAddr;
+	dmaChannel->DMACCLLI = _dmaLLI[0].nextLLI;
+	dmaChannel->DMACCControl = _dmaLLI[0].control;
+	dmaChannel->DMACCConfig = ( 1 << 0 ) |			/* Channel enabled */
+			( AnalogIn_DMA_REQUEST << 1 ) |			/* Source peripheral is the ADC */
+			( 2 << 11 ) |							/* Peripheral to memory */
+			( 1 << 14 ) |							/* Error interrupt */
+			( 1 << 15 );							/* Terminal count interrupt */
+
+	NVIC_EnableIRQ(DMA_IRQn);
+
+	/* Every selected channel requests DMA on DONE, the ADC interrupt itself stays off */
+	LPC_ADC->ADINTEN = selMask;
 
+	LPC_ADC->ADCR &= 0xF8FEFF00;				/* No START, no BURST, no channel */
+	LPC_ADC->ADCR |= (0x1 << 16) | selMask;		/* BURST scan of every selected channel */
+}
+
+/**
+ * Stops the DMA acquisition started by AnalogIn_startDMA.
+ */
+void AnalogIn_stopDMA(){
 
-	regVal = *(lpc_adc_addr[channel]);
-	return regVal;
+	if(!_dmaRunning){
+		return;
+	}
+
+	BITBAND_CLEAR_BIT(LPC_ADC->ADCR, 16);	/* Stop BURST */
+	LPC_ADC->ADINTEN = _irqChannels;	/* Back to the background channels */
 
+	LPC_GPDMACH0->DMACCConfig &= ~0x01;	/* Disable the channel */
+	LPC_GPDMA->DMACIntTCClear = (0x1 << AnalogIn_DMA_CHANNEL);
+	LPC_GPDMA->DMACIntErrClr = (0x1 << AnalogIn_DMA_CHANNEL);
+
+	_dmaRunning = false;
+	_busyChannel = ADC_NO_CHANNEL;
+	AnalogIn_release();
+}
+
+/**
+ * Returns the block most recently filled by the DMA.
+ * It remains valid until the DMA wraps around and starts filling it again (one block time).
+ */
+uint32_t* AnalogIn_getDMABlock(){
+	return _dmaBlock[_dmaCompletedBlock];
+}
+
+/**
+ * Handler to process interruptions of the GPDMA channel used by the ADC.
+ * This function is called once per filled block.
+ */
+void AnalogIn_DMA_default_handler(){
+
+	uint32_t channelMask = (0x1 << AnalogIn_DMA_CHANNEL);
+
+	if(LPC_GPDMA->DMACIntErrStat & channelMask){
+		LPC_GPDMA->DMACIntErrClr = channelMask;
+	}
+
+	if(LPC_GPDMA->DMACIntTCStat & channelMask){
+		LPC_GPDMA->DMACIntTCClear = channelMask;
+
+		/* The block that was being written when the LLI reloaded is the completed one */
+		_dmaCompletedBlock = (LPC_GPDMACH0->DMACCLLI == (uint32_t) &_dmaLLI[0]) ? 0 : 1;
+
+		if(_dmaBlockHandler != NULL){
+			_dmaBlockHandler();
+		}
+	}
 }
 
 #endif // TARGET_LPC17XX
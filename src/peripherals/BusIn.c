@@ -0,0 +1,107 @@
+/**************************************************************************//**
+ *
+ * @file     BusIn.c
+ * @author	 David Alain <dnascimento@fitec.org.br>
+ * @brief    File with functions to read a parallel bus of digital inputs.
+ * @version  V1.0
+ *
+ ******************************************************************************/
+#include "peripherals/BusIn.h"
+#include "peripherals/DigitalIn.h"
+
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+extern LPC_GPIO_TypeDef (* const LPC_GPIO[4]);
+#elif defined (TARGET_LPC17XX)
+extern LPC_GPIO_TypeDef (* const LPC_GPIO[5]);
+#endif
+
+
+/**
+ * Initializes a bus of digital inputs and precomputes the tables used to read it.
+ * pins[0] is the least significant bit of the value.
+ * All pins must be on the same port, so the whole bus is read at once.
+ *
+ * @param bus Bus object allocated by the user.
+ * @param pins Pins of the bus, from bit 0 up.
+ * @param count Number of pins, up to BusIn_MAX_PINS.
+ * @return false if there are too many pins or they are not on the same port.
+ */
+bool BusIn_Init(BusInObj* bus, const PinName* pins, uint8_t count){
+
+	uint8_t i, nibble, portBits;
+
+	if(count == 0 || count > BusIn_MAX_PINS){
+		return false;
+	}
+
+	bus->portNum = GET_PORT_NUM(pins[0]);
+	bus->width = count;
+	bus->shift = pins[0] & 0x1F;
+	bus->contiguous = true;
+	bus->mask = 0;
+	bus->nibbleCount = 0;
+
+	for(i = 0 ; i < count ; i++){
+		if(GET_PORT_NUM(pins[i]) != bus->portNum){
+			return false;
+		}
+		if((pins[i] & 0x1F) != bus->shift + i){
+			bus->contiguous = false;
+		}
+		bus->mask |= GET_MASK_NUM(pins[i]);
+		DigitalIn_Init(pins[i]);
+	}
+
+	/* gather[k][v]: value bits when the k-th used nibble of the port reads v */
+	for(nibble = 0 ; nibble < 8 ; nibble++){
+
+		if(((bus->mask >> (nibble * 4)) & 0x0F) == 0){
+			continue;
+		}
+
+		for(portBits = 0 ; portBits < 16 ; portBits++){
+			bus->gather[bus->nibbleCount][portBits] = 0;
+			for(i = 0 ; i < count ; i++){
+				if(((pins[i] & 0x1F) >> 2) == nibble && (portBits & (0x1 << (pins[i] & 0x03)))){
+					bus->gather[bus->nibbleCount][portBits] |= (0x1 << i);
+				}
+			}
+		}
+
+		bus->nibbleShift[bus->nibbleCount] = nibble * 4;
+		bus->nibbleCount++;
+	}
+
+	return true;
+}
+
+/**
+ * Reads the bus.
+ * All pins are sampled together with one load (MASKED_ACCESS slot of the bus mask on LPC13xx/LPC111X,
+ * FIOPIN on LPC17xx) and the bits are gathered into the value by the tables built in BusIn_Init.
+ *
+ * @param bus Bus object initialized by BusIn_Init.
+ * @return the value, bit n from pins[n] of BusIn_Init.
+ */
+uint32_t BusIn_read(BusInObj* bus){
+
+	uint32_t bits;
+	uint32_t value = 0;
+	uint8_t k;
+
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+	bits = LPC_GPIO[bus->portNum]->MASKED_ACCESS[bus->mask];
+#elif defined (TARGET_LPC17XX)
+	bits = LPC_GPIO[bus->portNum]->FIOPIN & bus->mask;
+#endif
+
+	if(bus->contiguous){
+		return bits >> bus->shift;
+	}
+
+	for(k = 0 ; k < bus->nibbleCount ; k++){
+		value |= bus->gather[k][(bits >> bus->nibbleShift[k]) & 0x0F];
+	}
+
+	return value;
+}
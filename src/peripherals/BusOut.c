@@ -0,0 +1,134 @@
+/**************************************************************************//**
+ *
+ * @file     BusOut.c
+ * @author	 David Alain <dnascimento@fitec.org.br>
+ * @brief    File with functions to control a parallel bus of digital outputs.
+ * @version  V1.0
+ *
+ ******************************************************************************/
+#include "peripherals/BusOut.h"
+#include "peripherals/DigitalOut.h"
+
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+extern LPC_GPIO_TypeDef (* const LPC_GPIO[4]);
+#elif defined (TARGET_LPC17XX)
+extern LPC_GPIO_TypeDef (* const LPC_GPIO[5]);
+#endif
+
+
+/**
+ * Initializes a bus of digital outputs and precomputes the tables used to write it.
+ * pins[0] is the least significant bit of the value.
+ * All pins must be on the same port, so the whole bus is written at once.
+ *
+ * @param bus Bus object allocated by the user.
+ * @param pins Pins of the bus, from bit 0 up.
+ * @param count Number of pins, up to BusOut_MAX_PINS.
+ * @return false if there are too many pins or they are not on the same port.
+ */
+bool BusOut_Init(BusOutObj* bus, const PinName* pins, uint8_t count){
+
+	uint8_t i, nibble, value;
+
+	if(count == 0 || count > BusOut_MAX_PINS){
+		return false;
+	}
+
+	bus->portNum = GET_PORT_NUM(pins[0]);
+	bus->width = count;
+	bus->shift = pins[0] & 0x1F;
+	bus->contiguous = true;
+	bus->mask = 0;
+
+	for(i = 0 ; i < count ; i++){
+		if(GET_PORT_NUM(pins[i]) != bus->portNum){
+			return false;
+		}
+		if((pins[i] & 0x1F) != bus->shift + i){
+			bus->contiguous = false;
+		}
+		bus->mask |= GET_MASK_NUM(pins[i]);
+		DigitalOut_Init(pins[i]);
+	}
+
+	/* scatter[n][v]: port bits to set when the nibble n of the value is v */
+	for(nibble = 0 ; nibble < (count + 3) / 4 ; nibble++){
+		for(value = 0 ; value < 16 ; value++){
+			bus->scatter[nibble][value] = 0;
+			for(i = 0 ; i < 4 && (nibble * 4 + i) < count ; i++){
+				if(value & (0x1 << i)){
+					bus->scatter[nibble][value] |= GET_MASK_NUM(pins[nibble * 4 + i]);
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Writes a value on the bus.
+ * Bit n of value is written on pins[n] of BusOut_Init; the other pins of the port are not changed.
+ *
+ * On LPC13xx/LPC111X all pins change together with one store in the MASKED_ACCESS slot of the bus mask.
+ * On LPC17xx the ones are written by FIOSET and then the zeros by FIOCLR, two stores that need no
+ * read-modify-write and no FIOMASK change, so they are safe against interrupts using other pins of the port.
+ *
+ * @param bus Bus object initialized by BusOut_Init.
+ * @param value Value to be written.
+ */
+void BusOut_write(BusOutObj* bus, uint32_t value){
+
+	uint32_t bits;
+	uint8_t nibble;
+
+	if(bus->contiguous){
+		bits = (value << bus->shift) & bus->mask;
+	}else{
+		bits = 0;
+		for(nibble = 0 ; nibble < (bus->width + 3) / 4 ; nibble++){
+			bits |= bus->scatter[nibble][(value >> (nibble * 4)) & 0x0F];
+		}
+	}
+
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+	LPC_GPIO[bus->portNum]->MASKED_ACCESS[bus->mask] = bits;
+#elif defined (TARGET_LPC17XX)
+	LPC_GPIO[bus->portNum]->FIOSET = bits;
+	LPC_GPIO[bus->portNum]->FIOCLR = bus->mask & ~bits;
+#endif
+}
+
+/**
+ * Reads back the value driven on the bus.
+ *
+ * @param bus Bus object initialized by BusOut_Init.
+ * @return the value, bit n from pins[n] of BusOut_Init.
+ */
+uint32_t BusOut_read(BusOutObj* bus){
+
+	uint32_t bits;
+	uint32_t value = 0;
+	uint8_t nibble, i;
+
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+	bits = LPC_GPIO[bus->portNum]->MASKED_ACCESS[bus->mask];
+#elif defined (TARGET_LPC17XX)
+	bits = LPC_GPIO[bus->portNum]->FIOPIN & bus->mask;
+#endif
+
+	if(bus->contiguous){
+		return bits >> bus->shift;
+	}
+
+	/* Not a fast path: search each bit in the scatter tables */
+	for(nibble = 0 ; nibble < (bus->width + 3) / 4 ; nibble++){
+		for(i = 0 ; i < 4 && (nibble * 4 + i) < bus->width ; i++){
+			if(bits & bus->scatter[nibble][0x1 << i]){
+				value |= (0x1 << (nibble * 4 + i));
+			}
+		}
+	}
+
+	return value;
+}
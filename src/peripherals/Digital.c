@@ -8,6 +8,7 @@
  ******************************************************************************/
 
 #include "peripherals/Digital.h"
+#include <stddef.h>
 
 #if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
 LPC_GPIO_TypeDef (* const LPC_GPIO[4]) = { LPC_GPIO0, LPC_GPIO1, LPC_GPIO2, LPC_GPIO3 };
@@ -17,7 +18,40 @@ LPC_GPIO_TypeDef (* const LPC_GPIO[5]) = { LPC_GPIO0, LPC_GPIO1, LPC_GPIO2, LPC_
 
 
 
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+#define Digital_IOCON_INDEX(reg)	(offsetof(LPC_IOCON_TypeDef, reg) / sizeof(uint32_t))
+#define Digital_NO_IOCON			0xFF
+
+/* Word index in LPC_IOCON of the register of each pin, indexed by GET_PIN_INDEX */
+static const uint8_t _ioconIndex[NUMBER_IO_PINS] = {
+		Digital_IOCON_INDEX(RESET_PIO0_0), Digital_IOCON_INDEX(PIO0_1), Digital_IOCON_INDEX(PIO0_2),
+		Digital_IOCON_INDEX(PIO0_3), Digital_IOCON_INDEX(PIO0_4), Digital_IOCON_INDEX(PIO0_5),
+		Digital_IOCON_INDEX(PIO0_6), Digital_IOCON_INDEX(PIO0_7), Digital_IOCON_INDEX(PIO0_8),
+		Digital_IOCON_INDEX(PIO0_9), Digital_IOCON_INDEX(SWCLK_PIO0_10), Digital_IOCON_INDEX(R_PIO0_11),
+
+		Digital_IOCON_INDEX(R_PIO1_0), Digital_IOCON_INDEX(R_PIO1_1), Digital_IOCON_INDEX(R_PIO1_2),
+		Digital_IOCON_INDEX(SWDIO_PIO1_3), Digital_IOCON_INDEX(PIO1_4), Digital_IOCON_INDEX(PIO1_5),
+		Digital_IOCON_INDEX(PIO1_6), Digital_IOCON_INDEX(PIO1_7), Digital_IOCON_INDEX(PIO1_8),
+		Digital_IOCON_INDEX(PIO1_9), Digital_IOCON_INDEX(PIO1_10), Digital_IOCON_INDEX(PIO1_11),
+
+		Digital_IOCON_INDEX(PIO2_0), Digital_IOCON_INDEX(PIO2_1), Digital_IOCON_INDEX(PIO2_2),
+		Digital_IOCON_INDEX(PIO2_3), Digital_IOCON_INDEX(PIO2_4), Digital_IOCON_INDEX(PIO2_5),
+		Digital_IOCON_INDEX(PIO2_6), Digital_IOCON_INDEX(PIO2_7), Digital_IOCON_INDEX(PIO2_8),
+		Digital_IOCON_INDEX(PIO2_9), Digital_IOCON_INDEX(PIO2_10), Digital_IOCON_INDEX(PIO2_11),
+
+		Digital_IOCON_INDEX(PIO3_0), Digital_IOCON_INDEX(PIO3_1), Digital_IOCON_INDEX(PIO3_2),
+		Digital_IOCON_INDEX(PIO3_3)
+};
+
+STATIC_ASSERT(sizeof(_ioconIndex) == NUMBER_IO_PINS, Digital_ioconIndex_must_cover_every_pin);
+STATIC_ASSERT(sizeof(LPC_IOCON_TypeDef) / sizeof(uint32_t) < Digital_NO_IOCON, Digital_ioconIndex_must_fit_uint8);
+#endif
+
 volatile uint32_t* Digital_getIOConfigRegister(PinName pin);
+#if defined (TARGET_LPC17XX)
+void Digital_setPinMode(PinName pin, uint32_t mode);
+void Digital_selectGPIO(PinName pin);
+#endif
 
 
 /**
@@ -34,15 +68,15 @@ void Digital_disablePull(PinName pin){
 #if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
 
 	volatile uint32_t* ioconReg = Digital_getIOConfigRegister(pin);
-	CLEAR_BIT(*ioconReg,4);
-	CLEAR_BIT(*ioconReg,3);
+	if(ioconReg == NULL){
+		return;
+	}
+	BITBAND_CLEAR_BIT(*ioconReg,4);
+	BITBAND_CLEAR_BIT(*ioconReg,3);
 
 #elif defined (TARGET_LPC17XX)
-	uint32_t mask = GET_MASK_NUM(pin);
-	volatile uint32_t * pincon = Digital_getIOConfigRegister(pin);
 	// Disable pull LPC1768 = 10b
-	CLEAR_BIT (*pincon, mask);
-	SET_BIT (*pincon, (mask + 1));
+	Digital_setPinMode(pin, 0x2);
 #endif
 }
 
@@ -61,17 +95,15 @@ void Digital_enablePullUp(PinName pin){
 #if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
 
 	volatile uint32_t* ioconReg = Digital_getIOConfigRegister(pin);
-	SET_BIT(*ioconReg,4);
-	CLEAR_BIT(*ioconReg,3);
+	if(ioconReg == NULL){
+		return;
+	}
+	BITBAND_SET_BIT(*ioconReg,4);
+	BITBAND_CLEAR_BIT(*ioconReg,3);
 
 #elif defined (TARGET_LPC17XX)
-	uint32_t portNum = GET_PORT_NUM(pin);
-	uint32_t mask = GET_MASK_NUM(pin);
-
-	volatile uint32_t * pincon = Digital_getIOConfigRegister(pin);
 	// Enable pull-up LPC1768 = 00b
-	CLEAR_BIT (*pincon, mask);
-	CLEAR_BIT (*pincon, (mask + 1));
+	Digital_setPinMode(pin, 0x0);
 #endif
 }
 
@@ -90,15 +122,15 @@ void Digital_enablePullDown(PinName pin){
 #if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
 
 	volatile uint32_t* ioconReg = Digital_getIOConfigRegister(pin);
-	SET_BIT(*ioconReg,3);
-	CLEAR_BIT(*ioconReg,4);
+	if(ioconReg == NULL){
+		return;
+	}
+	BITBAND_SET_BIT(*ioconReg,3);
+	BITBAND_CLEAR_BIT(*ioconReg,4);
 
 #elif defined (TARGET_LPC17XX)
-	uint32_t mask = GET_MASK_NUM(pin);
-	volatile uint32_t * pincon = Digital_getIOConfigRegister(pin);
 	// Enable pull-down LPC1768 = 11b
-	SET_BIT (*pincon, mask);
-	SET_BIT (*pincon, (mask + 1));
+	Digital_setPinMode(pin, 0x3);
 #endif
 }
 
@@ -122,115 +154,278 @@ void Digital_enableRepeater(PinName pin){
 #if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
 
 	volatile uint32_t* ioconReg = Digital_getIOConfigRegister(pin);
-	SET_BIT(*ioconReg,3);
-	SET_BIT(*ioconReg,4);
+	if(ioconReg == NULL){
+		return;
+	}
+	BITBAND_SET_BIT(*ioconReg,3);
+	BITBAND_SET_BIT(*ioconReg,4);
 
 #elif defined (TARGET_LPC17XX)
-	uint32_t mask = GET_MASK_NUM(pin);
-	volatile uint32_t * pincon = Digital_getIOConfigRegister(pin);
 	// Enable repeater LPC1768 = 01b
-	SET_BIT (*pincon, mask);
-	CLEAR_BIT (*pincon, (mask + 1));
+	Digital_setPinMode(pin, 0x1);
 #endif
 }
 
+/**
+ * Enables open-drain output on pin: a high level releases the pin instead of driving it.
+ * On LPC13xx/LPC111X this is the pseudo open-drain mode of IOCON (bit 10), the I2C pins
+ * (P0_4 and P0_5) are true open-drain and are not affected.
+ *
+ * @param pin
+ */
+void Digital_enableOpenDrain(PinName pin){
+
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+	volatile uint32_t* ioconReg = Digital_getIOConfigRegister(pin);
+	if(ioconReg == NULL){
+		return;
+	}
+	BITBAND_SET_BIT(*ioconReg,10);
+#elif defined (TARGET_LPC17XX)
+	BITBAND_SET_BIT((&LPC_PINCON->PINMODE_OD0)[GET_PORT_NUM(pin)], pin & 0x1F);
+#endif
+}
 
 /**
- * Auxiliary function that returns the LPC_IOCON->PIO related to pin.
+ * Disables open-drain output on pin (normal push-pull output).
  *
  * @param pin
- * @return pointer to LPC_IOCON->PIO
  */
-volatile uint32_t* Digital_getIOConfigRegister(PinName pin){
+void Digital_disableOpenDrain(PinName pin){
+
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+	volatile uint32_t* ioconReg = Digital_getIOConfigRegister(pin);
+	if(ioconReg == NULL){
+		return;
+	}
+	BITBAND_CLEAR_BIT(*ioconReg,10);
+#elif defined (TARGET_LPC17XX)
+	BITBAND_CLEAR_BIT((&LPC_PINCON->PINMODE_OD0)[GET_PORT_NUM(pin)], pin & 0x1F);
+#endif
+}
+
+/**
+ * Writes several pins of a port at the same time; the other pins of the port are not changed.
+ * On LPC13xx/LPC111X it is one store in MASKED_ACCESS[mask]. On LPC17xx FIOMASK hides the other pins
+ * during one FIOPIN store, with the interrupts disabled because FIOMASK is shared by the whole port.
+ *
+ * @param portNum Port number (0, 1, 2, ...).
+ * @param mask Pins to write (bit n = pin n of the port).
+ * @param value Levels of the pins in mask.
+ */
+void Digital_writePort(uint8_t portNum, uint32_t mask, uint32_t value){
+
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+	LPC_GPIO[portNum]->MASKED_ACCESS[mask & 0xFFF] = value;
+#elif defined (TARGET_LPC17XX)
+	uint32_t primask = __get_PRIMASK();
+	uint32_t fioMask;
+
+	__disable_irq();
+	fioMask = LPC_GPIO[portNum]->FIOMASK;
+	LPC_GPIO[portNum]->FIOMASK = ~mask;
+	LPC_GPIO[portNum]->FIOPIN = value;
+	LPC_GPIO[portNum]->FIOMASK = fioMask;
+	__set_PRIMASK(primask);
+#endif
+}
+
+/**
+ * Reads several pins of a port at the same time.
+ *
+ * @param portNum Port number (0, 1, 2, ...).
+ * @param mask Pins to read (bit n = pin n of the port).
+ * @return levels of the pins in mask, the other bits are zero.
+ */
+uint32_t Digital_readPort(uint8_t portNum, uint32_t mask){
+
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+	return LPC_GPIO[portNum]->MASKED_ACCESS[mask & 0xFFF];
+#elif defined (TARGET_LPC17XX)
+	return LPC_GPIO[portNum]->FIOPIN & mask;
+#endif
+}
+
+#if defined (TARGET_LPC17XX)
+/**
+ * Auxiliary function that writes the 2 bits PINMODE field of pin.
+ * Each bit is written by bit-band, so other pins of the register are never disturbed by an interrupt.
+ *
+ * @param pin
+ * @param mode 00b pull-up, 01b repeater, 10b no pull, 11b pull-down.
+ */
+void Digital_setPinMode(PinName pin, uint32_t mode){
+
+	volatile uint32_t* pinmode = Digital_getIOConfigRegister(pin);
+	uint32_t bitNum = (pin & 0x0F) * 2;
+
+	if(pinmode == NULL){
+		return;
+	}
 
-	uint32_t portNum = GET_PORT_NUM(pin);
-	uint32_t mask = GET_MASK_NUM(pin);
+	if(mode & 0x1){
+		BITBAND_SET_BIT(*pinmode, bitNum);
+	}else{
+		BITBAND_CLEAR_BIT(*pinmode, bitNum);
+	}
+
+	if(mode & 0x2){
+		BITBAND_SET_BIT(*pinmode, bitNum + 1);
+	}else{
+		BITBAND_CLEAR_BIT(*pinmode, bitNum + 1);
+	}
+}
+
+/**
+ * Auxiliary function that selects the GPIO function (PINSEL = 00b) on pin.
+ *
+ * @param pin
+ */
+void Digital_selectGPIO(PinName pin){
+
+	volatile uint32_t* pinsel = (&LPC_PINCON->PINSEL0) + (pin >> 4);
+	uint32_t bitNum = (pin & 0x0F) * 2;
+
+	BITBAND_CLEAR_BIT(*pinsel, bitNum);
+	BITBAND_CLEAR_BIT(*pinsel, bitNum + 1);
+}
+#endif
+
+/**
+ * Applies a board pin configuration table in one pass.
+ * Each entry gives the function, pull mode, direction and initial level of one pin, so the whole
+ * board configuration can be kept (and reviewed) in a single const table in flash.
+ *
+ * The GPIO clocks are enabled once, the output levels are written before the pins become outputs
+ * (no glitch), and the direction of each port is written once. On LPC17xx each PINSEL/PINMODE
+ * register touched by the table is written once too.
+ *
+ * Example:
+ *     static const PinConfig board[] = {
+ *         { P0_7, 0, PIN_MODE_NO_PULL, PIN_OUTPUT, 1 },		// LED, off
+ *         { P1_4, 0, PIN_MODE_PULL_UP, PIN_INPUT, 0 },			// button
+ *     };
+ *     Digital_configurePins(board, Digital_TABLE_SIZE(board));
+ *
+ * @param table Pin configuration entries.
+ * @param count Number of entries.
+ *
+ * @see PinConfig
+ */
+void Digital_configurePins(const PinConfig* table, uint16_t count){
+
+	uint32_t outputs[Digital_PORTS] = {0};
+	uint32_t inputs[Digital_PORTS] = {0};
+	uint32_t high[Digital_PORTS] = {0};
+	uint32_t portNum;
+	uint16_t i;
 
 #if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
-	volatile uint32_t *ioconReg = 0;
-
-	if(portNum == 0){
-		switch(mask){
-		case 1: ioconReg = &LPC_IOCON->PIO0_1; break;
-		case 2:	ioconReg = &LPC_IOCON->PIO0_2; break;
-		case 3: ioconReg = &LPC_IOCON->PIO0_3; break;
-		case 4: ioconReg = &LPC_IOCON->PIO0_4; break;
-		case 5: ioconReg = &LPC_IOCON->PIO0_5; break;
-		case 6: ioconReg = &LPC_IOCON->PIO0_6; break;
-		case 7: ioconReg = &LPC_IOCON->PIO0_7; break;
-		case 8: ioconReg = &LPC_IOCON->PIO0_8; break;
-		case 9: ioconReg = &LPC_IOCON->PIO0_9; break;
+
+	/* Function and mode of each pin (IOCON is one register per pin, reserved bit 6 and ADMODE bit 7 = digital) */
+	static const uint8_t modeBits[4] = {0x0 << 3, 0x2 << 3, 0x1 << 3, 0x3 << 3};
+
+	LPC_SYSCON->SYSAHBCLKCTRL |= (0x1 << 6) | (0x1 << 16);	/* GPIO and IOCON clocks */
+
+	for(i = 0 ; i < count ; i++){
+		volatile uint32_t* ioconReg = Digital_getIOConfigRegister(table[i].pin);
+		if(ioconReg == NULL){
+			continue;
 		}
-	}else if(portNum == 1){
-		switch(mask){
-		case 4: ioconReg = &LPC_IOCON->PIO1_4; break;
-		case 5: ioconReg = &LPC_IOCON->PIO1_5; break;
-		case 6: ioconReg = &LPC_IOCON->PIO1_6; break;
-		case 7: ioconReg = &LPC_IOCON->PIO1_7; break;
-		case 8: ioconReg = &LPC_IOCON->PIO1_8; break;
-		case 9: ioconReg = &LPC_IOCON->PIO1_9; break;
-		case 10: ioconReg = &LPC_IOCON->PIO1_10; break;
-		case 11: ioconReg = &LPC_IOCON->PIO1_11; break;
+		if(table[i].direction == PIN_ANALOG){
+			*ioconReg = (table[i].function & 0x07);
+		}else{
+			*ioconReg = 0xC0 | modeBits[table[i].mode] | (table[i].function & 0x07);
 		}
-	}else if(portNum == 2){
-		switch(mask){
-		case 0: ioconReg = &LPC_IOCON->PIO2_0; break;
-		case 1: ioconReg = &LPC_IOCON->PIO2_1; break;
-		case 2:	ioconReg = &LPC_IOCON->PIO2_2; break;
-		case 3: ioconReg = &LPC_IOCON->PIO2_3; break;
-		case 4: ioconReg = &LPC_IOCON->PIO2_4; break;
-		case 5: ioconReg = &LPC_IOCON->PIO2_5; break;
-		case 6: ioconReg = &LPC_IOCON->PIO2_6; break;
-		case 7: ioconReg = &LPC_IOCON->PIO2_7; break;
-		case 8: ioconReg = &LPC_IOCON->PIO2_8; break;
-		case 9: ioconReg = &LPC_IOCON->PIO2_9; break;
-		case 10: ioconReg = &LPC_IOCON->PIO2_10; break;
-		case 11: ioconReg = &LPC_IOCON->PIO2_11; break;
+	}
+
+#elif defined (TARGET_LPC17XX)
+
+	/* PINSEL0..10 and PINMODE0..9: 16 pins per register, 2 bits per pin */
+	uint32_t selMask[11] = {0}, selValue[11] = {0};
+	uint32_t modeMask[10] = {0}, modeValue[10] = {0};
+	static const uint8_t modeBits[4] = {0x2, 0x0, 0x3, 0x1};
+	uint32_t regIndex, shift;
+
+	for(i = 0 ; i < count ; i++){
+		PinName pin = table[i].pin;
+		PinMode mode = (table[i].direction == PIN_ANALOG) ? PIN_MODE_NO_PULL : table[i].mode;
+
+		regIndex = (GET_PORT_NUM(pin) * 2) + ((pin & 0x1F) >> 4);
+		shift = (pin & 0x0F) * 2;
+
+		selMask[regIndex] |= (0x3 << shift);
+		selValue[regIndex] |= ((table[i].function & 0x3) << shift);
+		modeMask[regIndex] |= (0x3 << shift);
+		modeValue[regIndex] |= (modeBits[mode] << shift);
+	}
+
+	for(regIndex = 0 ; regIndex < 11 ; regIndex++){
+		if(selMask[regIndex] != 0){
+			(&LPC_PINCON->PINSEL0)[regIndex] = ((&LPC_PINCON->PINSEL0)[regIndex] & ~selMask[regIndex]) | selValue[regIndex];
 		}
-	}else if(portNum == 3){
-		switch(mask){
-		case 0: ioconReg = &LPC_IOCON->PIO3_0; break;
-		case 1: ioconReg = &LPC_IOCON->PIO3_1; break;
-		case 2:	ioconReg = &LPC_IOCON->PIO3_2; break;
-		case 3: ioconReg = &LPC_IOCON->PIO3_3; break;
+		if(regIndex < 10 && modeMask[regIndex] != 0){
+			(&LPC_PINCON->PINMODE0)[regIndex] = ((&LPC_PINCON->PINMODE0)[regIndex] & ~modeMask[regIndex]) | modeValue[regIndex];
 		}
 	}
 
-	return ioconReg;
-#elif defined (TARGET_LPC17XX)
+#endif
 
-	volatile uint32_t *ret_reg = 0;
-	switch (portNum) {
-	case 0:
-		if (mask < 15)	ret_reg = &LPC_PINCON->PINMODE0;
-		else		ret_reg = &LPC_PINCON->PINMODE1;
-		break;
+	/* GPIO direction and initial level, grouped by port */
+	for(i = 0 ; i < count ; i++){
+		portNum = GET_PORT_NUM(table[i].pin);
+		if(table[i].direction == PIN_OUTPUT){
+			outputs[portNum] |= GET_MASK_NUM(table[i].pin);
+			if(table[i].level){
+				high[portNum] |= GET_MASK_NUM(table[i].pin);
+			}
+		}else{
+			inputs[portNum] |= GET_MASK_NUM(table[i].pin);
+		}
+	}
 
-	case 1:
-		if (mask < 15)	ret_reg = &LPC_PINCON->PINMODE2;
-		else		ret_reg = &LPC_PINCON->PINMODE3;
-		break;
+	for(portNum = 0 ; portNum < Digital_PORTS ; portNum++){
 
-	case 2:
-		ret_reg = &LPC_PINCON->PINMODE4;
-		// NOTE: PINMODE5 is not used
-		break;
+		if((outputs[portNum] | inputs[portNum]) == 0){
+			continue;
+		}
 
-	case 3:
-		// NOTE: PINMODE6 is not used
-		ret_reg = &LPC_PINCON->PINMODE7;
-		break;
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+		LPC_GPIO[portNum]->MASKED_ACCESS[outputs[portNum]] = high[portNum];
+		LPC_GPIO[portNum]->DIR = (LPC_GPIO[portNum]->DIR & ~inputs[portNum]) | outputs[portNum];
+#elif defined (TARGET_LPC17XX)
+		LPC_GPIO[portNum]->FIOMASK &= ~(outputs[portNum] | inputs[portNum]);
+		LPC_GPIO[portNum]->FIOSET = high[portNum];
+		LPC_GPIO[portNum]->FIOCLR = outputs[portNum] & ~high[portNum];
+		LPC_GPIO[portNum]->FIODIR = (LPC_GPIO[portNum]->FIODIR & ~inputs[portNum]) | outputs[portNum];
+#endif
+	}
+}
 
-	case 4:
-		// NOTE: PINMODE8 is not used
-		ret_reg = &LPC_PINCON->PINMODE9;
-		break;
 
-	default:
-		break;
+/**
+ * Auxiliary function that returns the LPC_IOCON->PIO related to pin.
+ * On LPC17xx it returns the PINMODE register that holds the pin (16 pins per register).
+ *
+ * @param pin
+ * @return pointer to LPC_IOCON->PIO, or NULL if pin has no I/O configuration register.
+ */
+volatile uint32_t* Digital_getIOConfigRegister(PinName pin){
+
+	if(!IS_VALID_PIN(pin)){
+		return NULL;
+	}
+
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+	uint8_t offset = _ioconIndex[GET_PIN_INDEX(pin)];
+
+	if(offset == Digital_NO_IOCON){
+		return NULL;
 	}
 
-	return ret_reg;
+	return ((volatile uint32_t*) LPC_IOCON) + offset;
+#elif defined (TARGET_LPC17XX)
+	return (&LPC_PINCON->PINMODE0) + (pin >> 4);
 #endif
 
 }
@@ -19,6 +19,21 @@ extern LPC_GPIO_TypeDef (* const LPC_GPIO[5]);
 
 
 extern volatile uint32_t* Digital_getIOConfigRegister(PinName pin);
+#if defined (TARGET_LPC17XX)
+extern void Digital_setPinMode(PinName pin, uint32_t mode);
+extern void Digital_selectGPIO(PinName pin);
+#endif
+
+typedef struct {
+	uint32_t enabled;			/* Debounced pins of the port */
+	volatile uint32_t state;	/* Debounced level */
+	uint32_t counter0;			/* Vertical counter, bit 0 */
+	uint32_t counter1;			/* Vertical counter, bit 1 */
+	volatile uint32_t rising;	/* Debounced rising edges not read yet */
+	volatile uint32_t falling;	/* Debounced falling edges not read yet */
+} DigitalInDebounce;
+
+static DigitalInDebounce _debounce[DigitalIn_PORTS];
 
 
 /**
@@ -28,23 +43,32 @@ extern volatile uint32_t* Digital_getIOConfigRegister(PinName pin);
  */
 void DigitalIn_Init(PinName pin){
 	uint32_t portNum = GET_PORT_NUM(pin);
-	uint32_t mask = GET_MASK_NUM(pin);
+
+	if(!IS_VALID_PIN(pin)){
+		return;
+	}
 
 #if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
-	SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 6); // This enable clock for GPIO pins
+	BITBAND_SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 6); // This enable clock for GPIO pins
 #elif defined (TARGET_LPC17XX)
-	LPC_GPIO[portNum]->FIOMASK &= ~mask;	// This enables the read/write of GPIO pins
+	BITBAND_CLEAR_BIT(LPC_GPIO[portNum]->FIOMASK, pin & 0x1F);	// This enables the read/write of GPIO pins
 #endif
 
 #if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
-	LPC_GPIO[portNum]->DIR &= ~mask;
+	LPC_GPIO[portNum]->DIR &= ~GET_MASK_NUM(pin);
 #elif defined (TARGET_LPC17XX)
-	LPC_GPIO[portNum]->FIODIR &= ~mask;
+	BITBAND_CLEAR_BIT(LPC_GPIO[portNum]->FIODIR, pin & 0x1F);
 #endif
 
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
 	volatile uint32_t* lpc_iocon_pioReg = Digital_getIOConfigRegister(pin);
 
 	(*lpc_iocon_pioReg) = (0xD0);
+#elif defined (TARGET_LPC17XX)
+	/* Same as LPC13xx: GPIO function with pull-up (PINMODE is shared by 16 pins, only this pin is changed) */
+	Digital_selectGPIO(pin);
+	Digital_setPinMode(pin, 0x0);
+#endif
 
 }
 
@@ -66,3 +90,167 @@ uint8_t DigitalIn_read (PinName pin)
 #endif
 
 }
+
+/******************************************************************************************
+ *
+ *				 	Debounce
+ *
+ ******************************************************************************************/
+
+/**
+ * Enables debouncing on pin.
+ * The pin must be initialized with DigitalIn_Init. Its debounced state starts at the current level.
+ * DigitalIn_debounceTick must be called periodically (see DigitalIn_startDebounce).
+ *
+ * @param pin
+ *
+ * @see DigitalIn_readDebounced
+ */
+void DigitalIn_enableDebounce(PinName pin){
+	uint32_t portNum = GET_PORT_NUM(pin);
+	uint32_t mask = GET_MASK_NUM(pin);
+	DigitalInDebounce* port = &_debounce[portNum];
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+
+	if(DigitalIn_read(pin)){
+		port->state |= mask;
+	}else{
+		port->state &= ~mask;
+	}
+	port->counter0 |= mask;
+	port->counter1 |= mask;
+	port->rising &= ~mask;
+	port->falling &= ~mask;
+	port->enabled |= mask;
+
+	__set_PRIMASK(primask);
+}
+
+/**
+ * Disables debouncing on pin.
+ *
+ * @param pin
+ */
+void DigitalIn_disableDebounce(PinName pin){
+	uint32_t portNum = GET_PORT_NUM(pin);
+	uint32_t mask = GET_MASK_NUM(pin);
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	_debounce[portNum].enabled &= ~mask;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * Samples every port with debounced pins and runs one step of the debounce.
+ * All pins of a port are processed together by a 2 bits vertical counter (one counter bit per word),
+ * so a pin changes its debounced state after DigitalIn_DEBOUNCE_SAMPLES equal samples different from it.
+ *
+ * Call it from a periodic interrupt (HardwareTimer, SysTick, ...), typically every 5ms.
+ */
+void DigitalIn_debounceTick(){
+
+	uint32_t portNum;
+	uint32_t sample;
+	uint32_t changed;
+	DigitalInDebounce* port;
+
+	for(portNum = 0 ; portNum < DigitalIn_PORTS ; portNum++){
+
+		port = &_debounce[portNum];
+		if(port->enabled == 0){
+			continue;
+		}
+
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+		sample = LPC_GPIO[portNum]->DATA;
+#elif defined (TARGET_LPC17XX)
+		sample = LPC_GPIO[portNum]->FIOPIN;
+#endif
+
+		/* Counters of the pins equal to the debounced state are kept at 3, the others count down to 0 */
+		changed = (port->state ^ sample) & port->enabled;
+		port->counter0 = ~(port->counter0 & changed);
+		port->counter1 = port->counter0 ^ (port->counter1 & changed);
+		changed &= port->counter0 & port->counter1;
+
+		port->state ^= changed;
+		port->rising |= changed & port->state;
+		port->falling |= changed & ~port->state;
+	}
+}
+
+/**
+ * Reads the debounced value of pin.
+ *
+ * @param pin
+ * @return 1 if the debounced level is high, 0 if it is low.
+ */
+uint8_t DigitalIn_readDebounced(PinName pin){
+	return (_debounce[GET_PORT_NUM(pin)].state & GET_MASK_NUM(pin)) ? 1 : 0;
+}
+
+/**
+ * Reads the debounced values of a whole port. Only the bits of debounced pins are meaningful.
+ *
+ * @param portNum Port number (0, 1, 2, ...).
+ * @return bit n is the debounced level of pin n of the port.
+ */
+uint32_t DigitalIn_readDebouncedPort(uint8_t portNum){
+	return _debounce[portNum].state;
+}
+
+/**
+ * Returns the pins of a port that had a debounced rising edge since the last call, and clears them.
+ *
+ * @param portNum Port number (0, 1, 2, ...).
+ * @return bit n is set if pin n of the port went from low to high.
+ */
+uint32_t DigitalIn_getRisingEdges(uint8_t portNum){
+	uint32_t edges;
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	edges = _debounce[portNum].rising;
+	_debounce[portNum].rising = 0;
+	__set_PRIMASK(primask);
+
+	return edges;
+}
+
+/**
+ * Returns the pins of a port that had a debounced falling edge since the last call, and clears them.
+ *
+ * @param portNum Port number (0, 1, 2, ...).
+ * @return bit n is set if pin n of the port went from high to low.
+ */
+uint32_t DigitalIn_getFallingEdges(uint8_t portNum){
+	uint32_t edges;
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	edges = _debounce[portNum].falling;
+	_debounce[portNum].falling = 0;
+	__set_PRIMASK(primask);
+
+	return edges;
+}
+
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+/**
+ * Runs DigitalIn_debounceTick on every interrupt of a hardware timer.
+ * The timer user handler is replaced.
+ *
+ * @param timerNum Hardware timer dedicated to debouncing.
+ * @param interval_us Sampling period in microseconds (a pin settles after DigitalIn_DEBOUNCE_SAMPLES periods).
+ *
+ * @see HardwareTimerNum
+ */
+void DigitalIn_startDebounce(HardwareTimerNum timerNum, uint32_t interval_us){
+	HardwareTimer_Init(timerNum, interval_us);
+	HardwareTimer_setUserHandler(timerNum, DigitalIn_debounceTick);
+	HardwareTimer_enable(timerNum);
+}
+#endif
@@ -8,6 +8,10 @@
  ******************************************************************************/
 #include "peripherals/DigitalOut.h"
 
+#if defined (TARGET_LPC17XX)
+extern void Digital_selectGPIO(PinName pin);
+#endif
+
 #if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
 extern LPC_GPIO_TypeDef (* const LPC_GPIO[4]);
 #elif defined (TARGET_LPC17XX)
@@ -23,24 +27,25 @@ extern LPC_GPIO_TypeDef (* const LPC_GPIO[5]);
 void DigitalOut_Init (PinName pin)
 {
 	uint32_t portNum = GET_PORT_NUM(pin);
-	uint32_t mask = GET_MASK_NUM(pin);
 
 #if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
-	SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 6); // This enable clock for GPIO pins
+	BITBAND_SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 6); // This enable clock for GPIO pins
 #elif defined (TARGET_LPC17XX)
-	LPC_GPIO[portNum]->FIOMASK &= ~mask;	// This enables the read/write of GPIO pins
+	BITBAND_CLEAR_BIT(LPC_GPIO[portNum]->FIOMASK, pin & 0x1F);	// This enables the read/write of GPIO pins
 #endif
 
 #if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
-	LPC_GPIO[portNum]->DIR |= mask;
+	LPC_GPIO[portNum]->DIR |= GET_MASK_NUM(pin);
 #elif defined (TARGET_LPC17XX)
-	LPC_GPIO[portNum]->FIODIR |= mask;
+	BITBAND_SET_BIT(LPC_GPIO[portNum]->FIODIR, pin & 0x1F);
+	Digital_selectGPIO(pin);
 #endif
 }
 
 /**
  * Writes a digital value on pin.
  * Out a low level on pin if value is zero, otherwise out high level on pin.
+ * For pins known at compile time DigitalFast_write is faster.
  *
  * @param pin
  * @param value
@@ -51,10 +56,8 @@ void DigitalOut_write (PinName pin, int32_t value) {
 	uint32_t mask = GET_MASK_NUM(pin);
 
 #if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
-	if (value)
-		LPC_GPIO[portNum]->MASKED_ACCESS[mask] |= mask;
-	else
-		LPC_GPIO[portNum]->MASKED_ACCESS[mask] &= ~mask;
+	/* Only the bit of this pin is written through MASKED_ACCESS, no read-modify-write needed */
+	LPC_GPIO[portNum]->MASKED_ACCESS[mask] = value ? mask : 0;
 #elif defined (TARGET_LPC17XX)
 	if (value)
 		LPC_GPIO[portNum]->FIOSET = mask;
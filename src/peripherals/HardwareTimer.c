@@ -15,6 +15,10 @@
 static uint32_t _timer_counter[TIMER_NUM];
 static uint32_t _timer_capture[TIMER_NUM];
 static FunctionPointer _userHandler[TIMER_NUM] = {NULL};
+static volatile bool _delayBusy[TIMER_NUM];
+static volatile uint32_t _delayRemaining[TIMER_NUM];
+static FunctionPointer _delayHandler[TIMER_NUM];
+static ContextHandler _userContextHandler[TIMER_NUM];
 
 static uint32_t _timerIntervalSoftwareTimer_us = -1;
 
@@ -46,6 +50,22 @@ LPC_TMR_TypeDef* HardwareTimer_getLPC_TMR(HardwareTimerNum timerNum)
 	return NULL;
 }
 
+static bool HardwareTimer_delayHandler(HardwareTimerNum timerNum);
+
+/**
+ * Auxiliary function that returns the interrupt number of a hardware timer.
+ *
+ * @param timerNum
+ *
+ * @see HardwareTimerNum
+ */
+IRQn_Type HardwareTimer_getIRQn(HardwareTimerNum timerNum)
+{
+	static const IRQn_Type irqn[TIMER_NUM] = {TIMER_16_0_IRQn, TIMER_16_1_IRQn, TIMER_32_0_IRQn, TIMER_32_1_IRQn};
+
+	return irqn[timerNum];
+}
+
 /**
  * Default handler to process hardware timer interrupts.
  *
@@ -55,6 +75,11 @@ LPC_TMR_TypeDef* HardwareTimer_getLPC_TMR(HardwareTimerNum timerNum)
 void HardwareTimer_default_handler(HardwareTimerNum timerNum)
 {
 	LPC_TMR_TypeDef* LPC_TMR = HardwareTimer_getLPC_TMR(timerNum);
+	uint32_t flags = LPC_TMR->IR;
+
+	if(HardwareTimer_delayHandler(timerNum)){
+		return;
+	}
 
 	if ( LPC_TMR->IR & 0x01 )
 	{
@@ -70,6 +95,7 @@ void HardwareTimer_default_handler(HardwareTimerNum timerNum)
 	if(_userHandler[timerNum] != NULL){
 		(_userHandler[timerNum])();
 	}
+	ContextHandler_call(&_userContextHandler[timerNum], timerNum, flags);
 
 	if(timerNum == HARDWARE_TIMER_32_0){
 		SoftwareTimer_incrementTimers(_timerIntervalSoftwareTimer_us);
@@ -89,39 +115,300 @@ void HardwareTimer_default_handler(HardwareTimerNum timerNum)
  */
 void HardwareTimer_setUserHandler(HardwareTimerNum timerNum, FunctionPointer usrHandler){
 	_userHandler[timerNum] = usrHandler;
+	_userContextHandler[timerNum].function = NULL;
+}
+
+/**
+ * Sets a user function that receives context, the timer number and the IR flags that
+ * caused the interrupt. Replaces the handler set with HardwareTimer_setUserHandler.
+ *
+ * @param timerNum Hardware timer
+ * @param usrHandler user's function
+ * @param context pointer passed back unchanged to usrHandler
+ *
+ * @see ContextFunctionPointer
+ */
+void HardwareTimer_setContextHandler(HardwareTimerNum timerNum, ContextFunctionPointer usrHandler, void* context){
+	_userHandler[timerNum] = NULL;
+	_userContextHandler[timerNum].context = context;
+	_userContextHandler[timerNum].function = usrHandler;
+}
+
+/**
+ * Returns the largest match value of a timer, 16 bit timers can not count past 0xFFFF.
+ */
+static inline uint32_t HardwareTimer_getMaxCount(HardwareTimerNum timerNum)
+{
+	return (timerNum == HARDWARE_TIMER_16_0 || timerNum == HARDWARE_TIMER_16_1) ? 0xFFFF : 0xFFFFFFFF;
 }
 
 /**
- * Delay using a hardware timer.
+ * Starts one delay period: the timer counts microseconds from zero and stops when
+ * it reaches delay_uS (at most HardwareTimer_getMaxCount).
+ *
+ * @param mcr 0x04 to stop on match, 0x05 to also interrupt
+ */
+static void HardwareTimer_startDelay(HardwareTimerNum timerNum, uint32_t delay_uS, uint32_t mcr)
+{
+	LPC_TMR_TypeDef* LPC_TMR = HardwareTimer_getLPC_TMR(timerNum);
+
+	BITBAND_SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, (timerNum + 7));
+
+	LPC_TMR->TCR = 0x02;		/* reset timer */
+	LPC_TMR->PR  = (SystemCoreClock / 1000000) - 1;	/* one count per microsecond */
+	LPC_TMR->MR0 = delay_uS;
+	LPC_TMR->IR  = 0xff;		/* reset all interrrupts */
+	LPC_TMR->MCR = mcr;
+	LPC_TMR->TCR = 0x01;		/* start timer */
+}
+
+/**
+ * Starts the next period of an interrupt driven delay, longer delays than the timer
+ * range are split in several periods.
+ */
+static void HardwareTimer_continueDelay(HardwareTimerNum timerNum)
+{
+	uint32_t period = _delayRemaining[timerNum];
+
+	if(period > HardwareTimer_getMaxCount(timerNum)){
+		period = HardwareTimer_getMaxCount(timerNum);
+	}
+	_delayRemaining[timerNum] -= period;
+
+	HardwareTimer_startDelay(timerNum, period, 0x05);	/* interrupt and stop on match */
+}
+
+/**
+ * Stops the delay running on the timer and drops its match, so it can not end the next delay.
+ * Must be called with the interrupts disabled.
+ */
+static void HardwareTimer_cancelDelay(HardwareTimerNum timerNum)
+{
+	LPC_TMR_TypeDef* LPC_TMR = HardwareTimer_getLPC_TMR(timerNum);
+
+	LPC_TMR->TCR = 0;
+	LPC_TMR->MCR = 0;
+	LPC_TMR->IR  = MATCH0;
+	NVIC_ClearPendingIRQ(HardwareTimer_getIRQn(timerNum));
+	_delayHandler[timerNum] = NULL;
+	_delayRemaining[timerNum] = 0;
+	_delayBusy[timerNum] = false;
+}
+
+/**
+ * Handles the match of an interrupt driven delay.
+ *
+ * @return true if the interrupt belonged to a delay
+ */
+static bool HardwareTimer_delayHandler(HardwareTimerNum timerNum)
+{
+	LPC_TMR_TypeDef* LPC_TMR = HardwareTimer_getLPC_TMR(timerNum);
+
+	if(!_delayBusy[timerNum] || !(LPC_TMR->IR & MATCH0)){
+		return false;
+	}
+
+	LPC_TMR->IR = MATCH0;
+
+	if(_delayRemaining[timerNum] != 0){
+		HardwareTimer_continueDelay(timerNum);
+		return true;
+	}
+
+	FunctionPointer handler = _delayHandler[timerNum];
+	_delayHandler[timerNum] = NULL;
+	_delayBusy[timerNum] = false;
+
+	if(handler != NULL){
+		handler();
+	}
+	return true;
+}
+
+/**
+ * Delay using a hardware timer, spinning until the time has elapsed.
  *
  * @param timerNum Hardware timer.
  * @param delay_uS time to wait in microseconds.
  *
  * @see HardwareTimerNum
+ * @see HardwareTimer_sleep_uS
  */
 void HardwareTimer_delay_uS(HardwareTimerNum timerNum, uint32_t delay_uS)
 {
 
 	LPC_TMR_TypeDef* LPC_TMR = HardwareTimer_getLPC_TMR(timerNum);
+	uint32_t maxCount = HardwareTimer_getMaxCount(timerNum);
 
-	uint8_t bitOffset = (timerNum + 7);
-	LPC_SYSCON->SYSAHBCLKCTRL |= (1 << bitOffset);
+	while(delay_uS != 0){
+		uint32_t period = (delay_uS > maxCount) ? maxCount : delay_uS;
+		delay_uS -= period;
 
-	/* setup timer for delay */
-	LPC_TMR->TCR = 0x02;		/* reset timer */
-	LPC_TMR->PR  = 0x00;		/* set prescaler to zero */
-#if defined (TARGET_LPC111X)
-	LPC_TMR->MR0 = delay_uS * ((SystemCoreClock/(LPC_TMR->PR+1)) / 1000*1000 );
-#elif defined (TARGET_LPC13XX)
-	LPC_TMR->MR0 = delay_uS * ((SystemFrequency/LPC_SYSCON->SYSAHBCLKDIV) / 1000*1000 );
+		HardwareTimer_startDelay(timerNum, period, 0x04);	/* stop timer on match */
+
+		/* wait until delay time has elapsed */
+		while (LPC_TMR->TCR & 0x01);
+	}
+
+}
+
+/**
+ * Delay using a hardware timer, sleeping in WFI until the match interrupt.
+ * Other interrupts keep being serviced during the delay. When called with the
+ * interrupts disabled it spins like HardwareTimer_delay_uS.
+ *
+ * Note: the timer user handler is not called for the delay interrupt.
+ *
+ * @param timerNum Hardware timer not used for anything else.
+ * @param delay_uS time to wait in microseconds.
+ *
+ * @see HardwareTimerNum
+ */
+void HardwareTimer_sleep_uS(HardwareTimerNum timerNum, uint32_t delay_uS)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	if(primask != 0){
+		HardwareTimer_delay_uS(timerNum, delay_uS);
+		return;
+	}
+
+	/* With PRIMASK set the match still wakes WFI, but its handler only runs once
+	   PRIMASK is cleared, so the end of the delay can not slip in before WFI */
+	__disable_irq();
+	HardwareTimer_delayAsync_uS(timerNum, delay_uS, NULL);
+	while(_delayBusy[timerNum]){
+		__WFI();
+		__enable_irq();
+		__disable_irq();
+	}
+	__set_PRIMASK(primask);
+}
+
+/**
+ * Starts a delay and returns at once, handler is called from the timer interrupt
+ * when it ends. A delay already running on the timer is replaced, a zero delay only
+ * cancels it and calls handler at once.
+ *
+ * Note: the timer user handler is not called for the delay interrupt.
+ *
+ * @param timerNum Hardware timer not used for anything else.
+ * @param delay_uS time to wait in microseconds.
+ * @param handler user's function, may be NULL
+ *
+ * @see HardwareTimer_isDelayRunning
+ */
+void HardwareTimer_delayAsync_uS(HardwareTimerNum timerNum, uint32_t delay_uS, FunctionPointer handler)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	/* The running delay is cancelled, its handler is not called */
+	HardwareTimer_cancelDelay(timerNum);
+
+	if(delay_uS == 0){
+		__set_PRIMASK(primask);
+		if(handler != NULL){
+			handler();
+		}
+		return;
+	}
+
+	_delayHandler[timerNum] = handler;
+	_delayRemaining[timerNum] = delay_uS;
+	_delayBusy[timerNum] = true;
+	HardwareTimer_continueDelay(timerNum);
+
+	NVIC_EnableIRQ(HardwareTimer_getIRQn(timerNum));
+
+	__set_PRIMASK(primask);
+}
+
+/**
+ * Returns true while a delay started by HardwareTimer_delayAsync_uS or HardwareTimer_sleep_uS runs.
+ *
+ * @param timerNum Hardware timer
+ */
+bool HardwareTimer_isDelayRunning(HardwareTimerNum timerNum)
+{
+	return _delayBusy[timerNum];
+}
+
+#if defined (TARGET_LPC13XX)
+#define DWT_CTRL	(*(volatile uint32_t*) 0xE0001000)
+#define DWT_CYCCNT	(*(volatile uint32_t*) 0xE0001004)
+#else
+static uint32_t _cyclesPerLoop;		/* Cycles of 256 iterations of HardwareTimer_spin, 0 until calibrated */
+
+static void __attribute__ ((noinline)) HardwareTimer_spin(uint32_t loops)
+{
+	while(loops--){
+		__NOP();
+	}
+}
+
+/**
+ * Measures the cost of HardwareTimer_spin with the SysTick counter, which counts core clock cycles.
+ */
+static void HardwareTimer_calibrateSpin()
+{
+	uint32_t primask = __get_PRIMASK();
+	uint32_t ctrl = SysTick->CTRL;
+	uint32_t load = SysTick->LOAD;
+	uint32_t start, end;
+
+	__disable_irq();
+
+	if(!(ctrl & 0x01)){
+		SysTick->LOAD = 0xFFFFFF;
+		SysTick->VAL  = 0;
+		SysTick->CTRL = 0x05;	/* core clock, no interrupt */
+		load = 0xFFFFFF;
+	}
+
+	start = SysTick->VAL;
+	HardwareTimer_spin(256);
+	end = SysTick->VAL;
+
+	if(!(ctrl & 0x01)){
+		SysTick->CTRL = ctrl;
+		SysTick->LOAD = 0;
+	}
+
+	__set_PRIMASK(primask);
+
+	/* SysTick counts down and reloads from LOAD */
+	_cyclesPerLoop = (start >= end) ? (start - end) : (start + load + 1 - end);
+}
 #endif
-	LPC_TMR->IR  = 0xff;		/* reset all interrrupts */
-	LPC_TMR->MCR = 0x04;		/* stop timer on match */
-	LPC_TMR->TCR = 0x01;		/* start timer */
 
-	/* wait until delay time has elapsed */
-	while (LPC_TMR->TCR & 0x01);
+/**
+ * Short delay counted in core clock cycles, for bit timing and peripheral setup times.
+ * On LPC13xx it waits on the DWT cycle counter, on LPC111x on a loop calibrated
+ * against SysTick at the first call. Accuracy is a few core cycles, and interrupts
+ * taken during the delay lengthen it. Delays must be shorter than 59 ms.
+ *
+ * @param delay_nS time to wait in nanoseconds.
+ */
+void HardwareTimer_delay_nS(uint32_t delay_nS)
+{
+	uint32_t cycles = (delay_nS * (SystemCoreClock / 1000000)) / 1000;
+
+#if defined (TARGET_LPC13XX)
+	if(!(DWT_CTRL & 0x01)){
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA;
+		DWT_CTRL |= 0x01;		/* CYCCNTENA */
+	}
+
+	uint32_t start = DWT_CYCCNT;
+	while((DWT_CYCCNT - start) < cycles);
+#else
+	if(_cyclesPerLoop == 0){
+		HardwareTimer_calibrateSpin();
+	}
 
+	HardwareTimer_spin((cycles << 8) / _cyclesPerLoop);
+#endif
 }
 
 
@@ -170,6 +457,38 @@ void HardwareTimer_reset(HardwareTimerNum timerNum)
 }
 
 
+/**
+ * Configures a hardware timer as a free-running microsecond counter and starts it.
+ * The timer counts up from zero, never raises interrupts and wraps at its width,
+ * so 16 bit timers overflow every 65.536 ms and 32 bit timers every 71.6 minutes.
+ *
+ * @param timerNum Hardware timer
+ *
+ * @see HardwareTimer_read
+ */
+void HardwareTimer_InitFreeRunning(HardwareTimerNum timerNum)
+{
+	LPC_TMR_TypeDef* LPC_TMR = HardwareTimer_getLPC_TMR(timerNum);
+
+	BITBAND_SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, (timerNum + 7));
+
+	LPC_TMR->TCR = 0x02;		/* reset timer */
+	LPC_TMR->PR  = (SystemCoreClock / 1000000) - 1;	/* one count per microsecond */
+	LPC_TMR->MCR = 0x00;		/* no match actions, count through the full range */
+	LPC_TMR->IR  = 0xff;		/* reset all interrupts */
+	LPC_TMR->TCR = 0x01;		/* start timer */
+}
+
+/**
+ * Returns the current count of a hardware timer.
+ *
+ * @param timerNum Hardware timer
+ */
+uint32_t HardwareTimer_read(HardwareTimerNum timerNum)
+{
+	return HardwareTimer_getLPC_TMR(timerNum)->TC;
+}
+
 /**
  * Initializes the hardware timer and configure it to count timerInterval_us microseconds.
  * Note: this function not start counting only configure the timer, to do this use HardwareTimer_enable.
@@ -189,7 +508,7 @@ void HardwareTimer_Init(HardwareTimerNum timerNum, uint32_t timerInterval_us)
 	{
 		/* Some of the I/O pins need to be carefully planned if
     you use below module because JTAG and TIMER CAP/MAT pins are muxed. */
-		LPC_SYSCON->SYSAHBCLKCTRL |= (1 << 9);
+		BITBAND_SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 9);
 //		LPC_IOCON->PIO1_5 &= ~0x07;	/*  Timer0_32 I/O config */
 //		LPC_IOCON->PIO1_5 |= 0x02;	/* Timer0_32 CAP0 */
 //		LPC_IOCON->PIO1_6 &= ~0x07;
@@ -231,7 +550,7 @@ void HardwareTimer_Init(HardwareTimerNum timerNum, uint32_t timerInterval_us)
 	{
 		/* Some of the I/O pins need to be clearfully planned if
     you use below module because JTAG and TIMER CAP/MAT pins are muxed. */
-		LPC_SYSCON->SYSAHBCLKCTRL |= (1<<10);
+		BITBAND_SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 10);
 #ifdef __JTAG_DISABLED
 		LPC_IOCON->JTAG_TMS_PIO1_0  &= ~0x07;	/*  Timer1_32 I/O config */
 		LPC_IOCON->JTAG_TMS_PIO1_0  |= 0x03;	/* Timer1_32 CAP0 */
@@ -268,7 +587,7 @@ void HardwareTimer_Init(HardwareTimerNum timerNum, uint32_t timerInterval_us)
 
 		/* Some of the I/O pins need to be clearfully planned if
 		    you use below module because JTAG and TIMER CAP/MAT pins are muxed. */
-		LPC_SYSCON->SYSAHBCLKCTRL |= (1<<7);
+		BITBAND_SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 7);
 //		LPC_IOCON->PIO0_2           &= ~0x07;	/*  Timer0_16 I/O config */
 //		LPC_IOCON->PIO0_2           |= 0x02;		/* Timer0_16 CAP0 */
 //		LPC_IOCON->PIO0_8           &= ~0x07;
@@ -303,7 +622,7 @@ void HardwareTimer_Init(HardwareTimerNum timerNum, uint32_t timerInterval_us)
 
 		/* Some of the I/O pins need to be clearfully planned if
 	    you use below module because JTAG and TIMER CAP/MAT pins are muxed. */
-		LPC_SYSCON->SYSAHBCLKCTRL |= (1<<8);
+		BITBAND_SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 8);
 //		LPC_IOCON->PIO1_8           &= ~0x07;	/*  Timer1_16 I/O config */
 //		LPC_IOCON->PIO1_8           |= 0x01;		/* Timer1_16 CAP0 */
 //		LPC_IOCON->PIO1_9           &= ~0x07;
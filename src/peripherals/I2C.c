@@ -20,6 +20,7 @@ static uint32_t _currentState[I2C_NUM];
 static volatile uint32_t _timeout;
 
 static FunctionPointer _userHandler[I2C_NUM] = {NULL};
+static ContextHandler _userContextHandler[I2C_NUM];
 
 
 
@@ -41,11 +42,11 @@ void I2C_Init(I2CPortNum port){
 	  and I2C use bit 0 for reset enable. Once the problem
 	  is fixed, change to "#if 1". */
 #if 1
-	LPC_SYSCON->PRESETCTRL |= (0x1<<1);
+	BITBAND_SET_BIT(LPC_SYSCON->PRESETCTRL, 1);
 #else
-	LPC_SYSCON->PRESETCTRL |= (0x1<<0);
+	BITBAND_SET_BIT(LPC_SYSCON->PRESETCTRL, 0);
 #endif
-	LPC_SYSCON->SYSAHBCLKCTRL |= (1<<5);
+	BITBAND_SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 5);
 	LPC_IOCON->PIO0_4 &= ~0x3F;	/*  I2C I/O config */
 	LPC_IOCON->PIO0_4 |= 0x01;		/* I2C SCL */
 	LPC_IOCON->PIO0_5 &= ~0x3F;
@@ -90,9 +91,10 @@ void I2C_Init(I2CPortNum port){
  */
 void I2C_default_handler(I2CPortNum port){
 
-#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
 	uint8_t statReg;
 
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+
 	_timeout = 0;
 
 	/* this handler deals with master read and master write only */
@@ -208,6 +210,7 @@ void I2C_default_handler(I2CPortNum port){
 	if(_userHandler[port] != NULL){
 		(_userHandler[port])();
 	}
+	ContextHandler_call(&_userContextHandler[port], port, statReg);
 
 }
 
@@ -222,6 +225,23 @@ void I2C_default_handler(I2CPortNum port){
  */
 void I2C_setUserHandler(I2CPortNum port, FunctionPointer ptr){
 	_userHandler[port] = ptr;
+	_userContextHandler[port].function = NULL;
+}
+
+/**
+ * Sets a user function that receives context, the port and the I2C status code of each
+ * interrupt. Replaces the handler set with I2C_setUserHandler.
+ *
+ * @param port A I2CPortNum.
+ * @param ptr User function handler.
+ * @param context pointer passed back unchanged to ptr
+ *
+ * @see I2CPortNum
+ */
+void I2C_setContextHandler(I2CPortNum port, ContextFunctionPointer ptr, void* context){
+	_userHandler[port] = NULL;
+	_userContextHandler[port].context = context;
+	_userContextHandler[port].function = ptr;
 }
 
 /**
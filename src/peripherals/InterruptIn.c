@@ -25,15 +25,67 @@
 
 
 #if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+#define InterruptIn_PORTS	4
 extern LPC_GPIO_TypeDef (* const LPC_GPIO[4]);
+
+/* On LPC13xx/LPC111x the EINTn vectors are the PIOINTn port interrupts */
+static const IRQn_Type LPC_IRQn_VEC[InterruptIn_PORTS] = {EINT0_IRQn, EINT1_IRQn, EINT2_IRQn, EINT3_IRQn};
 #elif defined (TARGET_LPC17XX)
+#define InterruptIn_PORTS	5
 extern LPC_GPIO_TypeDef (* const LPC_GPIO[5]);
+extern void Digital_selectGPIO(PinName pin);
+
+/* Only ports 0 and 2 have interrupts and both share EINT3 with the external interrupt 3 pin */
+static const IRQn_Type LPC_IRQn_VEC[InterruptIn_PORTS] = {EINT3_IRQn, EINT3_IRQn, EINT3_IRQn, EINT3_IRQn, EINT3_IRQn};
+
+/* IO0 and IO2 interrupt registers have the same layout, 0x20 bytes apart */
+typedef struct{
+	__I  uint32_t StatR;
+	__I  uint32_t StatF;
+	__O  uint32_t Clr;
+	__IO uint32_t EnR;
+	__IO uint32_t EnF;
+}InterruptIn_GPIOINT_TypeDef;
+
+static InterruptIn_GPIOINT_TypeDef* const LPC_GPIOINT_PORT[InterruptIn_PORTS] = {
+	(InterruptIn_GPIOINT_TypeDef*) &(LPC_GPIOINT->IO0IntStatR),
+	NULL,
+	(InterruptIn_GPIOINT_TypeDef*) &(LPC_GPIOINT->IO2IntStatR),
+	NULL,
+	NULL
+};
+
+#define InterruptIn_HAS_INTERRUPT(portNum)	((portNum) == 0 || (portNum) == 2)
+
+/* Edges selected by InterruptIn_configure, written to IntEnR/IntEnF by InterruptIn_enable */
+static uint32_t _risingPins[InterruptIn_PORTS];
+static uint32_t _fallingPins[InterruptIn_PORTS];
 #endif
 
-//This array maybe work in both microcontrollers
-static const IRQn_Type LPC_IRQn_VEC[4] = {EINT0_IRQn, EINT1_IRQn, EINT2_IRQn, EINT3_IRQn};
-
 extern FunctionPointer _userHandlerPtr[NUMBER_IO_PINS];
+extern ContextHandler _userContextHandler[NUMBER_IO_PINS];
+
+/* Edge event ring, filled by the port handlers and drained by the application */
+static InterruptInEvent* _eventBuffer = NULL;
+static uint16_t _eventBufferSize;
+static volatile uint16_t _eventHead;		// Written by the interrupt handlers, under PRIMASK
+static volatile uint16_t _eventTail;		// Written only by the reader
+static volatile uint32_t _eventsLost;
+static volatile uint32_t* _eventClock;		// TC register of the timestamp timer
+static uint32_t _queuedPins[InterruptIn_PORTS];
+
+/* Interrupt storm protection, see InterruptIn_setRateLimit */
+typedef struct{
+	uint8_t maxEvents;			// Events accepted per window, 0 when the pin is not limited
+	volatile uint8_t events;	// Events seen in the current window
+	volatile uint8_t cooldown;	// Windows left before a masked pin is enabled again
+	volatile uint16_t limits;	// Times the pin was masked
+}InterruptInRateLimit;
+
+static InterruptInRateLimit _rateLimit[NUMBER_IO_PINS];
+static uint32_t _rateLimitedPins[InterruptIn_PORTS];
+
+#define InterruptIn_COOLDOWN_WINDOWS	2	// Masked for at least one full window
 
 
 void InterruptIn_Init(PinName pin)
@@ -42,10 +94,15 @@ void InterruptIn_Init(PinName pin)
 	uint32_t mask = GET_MASK_NUM(pin);
 
 #if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
-	SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 6); // This enable clock for GPIO pins
+	BITBAND_SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 6); // This enable clock for GPIO pins
 	LPC_GPIO[portNum]->DIR &= ~mask;
 #elif defined (TARGET_LPC17XX)
+	if(!InterruptIn_HAS_INTERRUPT(portNum)){
+		return;
+	}
+	Digital_selectGPIO(pin);
 	LPC_GPIO[portNum]->FIOMASK &= ~mask;	// This enables the read/write of GPIO pins
+	LPC_GPIO[portNum]->FIODIR &= ~mask;
 #endif
 
 	NVIC_EnableIRQ(LPC_IRQn_VEC[portNum]);
@@ -77,7 +134,29 @@ void InterruptIn_configure (PinName pin, InterruptSense sense, InterruptEdge edg
 	}
 
 #elif defined (TARGET_LPC17XX)
-#error Implement InterruptIn::configure for LPC1768
+	/* The LPC17xx GPIO only detects edges, LEVEL sense falls back to the edge entering that level */
+	(void) sense;
+
+	if(!InterruptIn_HAS_INTERRUPT(portNum)){
+		return;
+	}
+
+	if ( edge == BOTH_EDGES || event == RISING_EDGE_OR_HIGH_LEVEL ){
+		_risingPins[portNum] |= mask;
+	}else{
+		_risingPins[portNum] &= ~mask;
+	}
+	if ( edge == BOTH_EDGES || event == FALL_EDGE_OR_LOW_LEVEL ){
+		_fallingPins[portNum] |= mask;
+	}else{
+		_fallingPins[portNum] &= ~mask;
+	}
+
+	/* Apply the new edges at once if the pin is already enabled */
+	InterruptIn_GPIOINT_TypeDef* gpioInt = LPC_GPIOINT_PORT[portNum];
+	if((gpioInt->EnR | gpioInt->EnF) & mask){
+		InterruptIn_enable(pin);
+	}
 #endif
 }
 
@@ -89,7 +168,11 @@ int32_t InterruptIn_read (PinName pin){
 #if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
 	return (LPC_GPIO[portNum]->MIS & mask) ? 1 : 0;
 #elif defined (TARGET_LPC17XX)
-#error Implement InterruptIn::getStatus for LPC1768
+	InterruptIn_GPIOINT_TypeDef* gpioInt = LPC_GPIOINT_PORT[portNum];
+	if(gpioInt == NULL){
+		return 0;
+	}
+	return ((gpioInt->StatR | gpioInt->StatF) & mask) ? 1 : 0;
 #endif
 }
 
@@ -101,7 +184,12 @@ void InterruptIn_enable (PinName pin){
 #if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
 	LPC_GPIO[portNum]->IE |= mask;
 #elif defined (TARGET_LPC17XX)
-#error Implement InterruptIn::enable for LPC1768
+	InterruptIn_GPIOINT_TypeDef* gpioInt = LPC_GPIOINT_PORT[portNum];
+	if(gpioInt == NULL){
+		return;
+	}
+	gpioInt->EnR = (gpioInt->EnR & ~mask) | (_risingPins[portNum] & mask);
+	gpioInt->EnF = (gpioInt->EnF & ~mask) | (_fallingPins[portNum] & mask);
 #endif
 }
 
@@ -110,10 +198,33 @@ void InterruptIn_disable (PinName pin){
 	uint32_t portNum = GET_PORT_NUM(pin);
 	uint32_t mask = GET_MASK_NUM(pin);
 
+	if(!IS_VALID_PIN(pin)){
+		return;
+	}
+
+	_rateLimit[GET_PIN_INDEX(pin)].cooldown = 0;	// Disabled by the user, the rate limiter must not enable it again
+
 #if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
 	LPC_GPIO[portNum]->IE &= ~mask;
 #elif defined (TARGET_LPC17XX)
-#error Implement InterruptIn::disable for LPC1768
+	InterruptIn_GPIOINT_TypeDef* gpioInt = LPC_GPIOINT_PORT[portNum];
+	if(gpioInt == NULL){
+		return;
+	}
+	gpioInt->EnR &= ~mask;
+	gpioInt->EnF &= ~mask;
+#endif
+}
+
+static uint32_t InterruptIn_readLevel(PinName pin){
+
+	uint32_t portNum = GET_PORT_NUM(pin);
+	uint32_t mask = GET_MASK_NUM(pin);
+
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+	return (LPC_GPIO[portNum]->MASKED_ACCESS[mask]) ? 1 : 0;
+#elif defined (TARGET_LPC17XX)
+	return (LPC_GPIO[portNum]->FIOPIN & mask) ? 1 : 0;
 #endif
 }
 
@@ -123,9 +234,11 @@ void InterruptIn_clear (PinName pin){
 	uint32_t mask = GET_MASK_NUM(pin);
 
 #if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
-	LPC_GPIO[portNum]->IC |= mask;
+	LPC_GPIO[portNum]->IC = mask;	// Write-only, one bits clear and zero bits are ignored
 #elif defined (TARGET_LPC17XX)
-#error Implement InterruptIn::clear for LPC1768
+	if(LPC_GPIOINT_PORT[portNum] != NULL){
+		LPC_GPIOINT_PORT[portNum]->Clr = mask;
+	}
 #endif
 
 }
@@ -138,13 +251,384 @@ void InterruptIn_default_handler(PinName pin){
 	if(_userHandlerPtr[pinIndex] != NULL){
 		(_userHandlerPtr[pinIndex])();
 	}
+	ContextHandler_call(&_userContextHandler[pinIndex], pin, InterruptIn_readLevel(pin));
+
+}
 
+/**
+ * Returns the number of the most significant set bit of a non-zero value.
+ */
+static inline uint8_t InterruptIn_highestBit(uint32_t value){
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC17XX)
+	return 31 - __builtin_clz(value);	// Single CLZ instruction on Cortex-M3
+#else
+	uint8_t bit = 0;					// Cortex-M0 has no CLZ, binary search the 12 pin bits
+
+	if(value & 0xF00){ value >>= 8; bit += 8; }
+	if(value & 0x0F0){ value >>= 4; bit += 4; }
+	if(value & 0x00C){ value >>= 2; bit += 2; }
+	if(value & 0x002){ bit += 1; }
+	return bit;
+#endif
 }
 
-void InterruptIn_setUserHandler(PinName pin, FunctionPointer usrHandler){
+/**
+ * Stores one event per pin in the ring, all stamped with the same timer count.
+ * When the ring is full the new events are dropped and counted as lost.
+ * The port handlers may preempt each other, so the head is claimed and published with the interrupts masked.
+ */
+static void InterruptIn_recordEvents(uint8_t portNum, uint32_t pins, uint32_t levels){
 
-	uint8_t pinIndex = GET_PIN_INDEX(pin);
-	_userHandlerPtr[pinIndex] = usrHandler;
+	uint32_t timestamp = *_eventClock;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	uint16_t head = _eventHead;
+
+	while(pins){
+		uint8_t bit = InterruptIn_highestBit(pins);
+		pins &= ~(1UL << bit);
+
+		uint16_t next = head + 1;
+		if(next == _eventBufferSize){
+			next = 0;
+		}
+		if(next == _eventTail){
+			_eventsLost++;
+			continue;
+		}
 
+		_eventBuffer[head].pin = (PinName)((portNum << 5) | bit);
+		_eventBuffer[head].level = (levels >> bit) & 1;
+		_eventBuffer[head].timestamp = timestamp;
+		head = next;
+	}
+
+	_eventHead = head;	// Publish the events only after they are complete
+
+	__set_PRIMASK(primask);
 }
 
+/**
+ * Counts one event for each rate limited pin and masks the pins going over their limit.
+ *
+ * @return pins masked now, their event is dropped
+ */
+static uint32_t InterruptIn_countEvents(uint8_t portNum, uint32_t pins){
+
+	uint32_t dropped = 0;
+
+	while(pins){
+		uint8_t bit = InterruptIn_highestBit(pins);
+		pins &= ~(1UL << bit);
+
+		PinName pin = (PinName)((portNum << 5) | bit);
+		InterruptInRateLimit* limit = &_rateLimit[GET_PIN_INDEX(pin)];
+
+		if(limit->events < limit->maxEvents){
+			limit->events++;
+		}else{
+			InterruptIn_disable(pin);
+			limit->cooldown = InterruptIn_COOLDOWN_WINDOWS;
+			limit->limits++;
+			dropped |= (1UL << bit);
+		}
+	}
+
+	return dropped;
+}
+
+/**
+ * Services every pending interrupt of a GPIO port from its PIOINTn handler
+ * (EINT3 handler on LPC17xx).
+ *
+ * All pins flagged in MIS (IntStatR/IntStatF on LPC17xx) are cleared with a single
+ * write before any user handler runs, so edges arriving while the handlers execute
+ * are flagged again and re-enter the interrupt instead of being lost. The pins are
+ * then dispatched from the highest pin number down, which is the service priority
+ * within a port.
+ *
+ * @param portNum GPIO port that raised the interrupt
+ */
+void InterruptIn_port_handler(uint8_t portNum){
+
+	uint32_t status;
+	uint32_t levels;
+
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+	status = LPC_GPIO[portNum]->MIS;
+
+	LPC_GPIO[portNum]->IC = status;
+	__NOP();	// The edge detector clear needs two cycles to reach the GPIO block
+	__NOP();
+
+	levels = status ? LPC_GPIO[portNum]->DATA : 0;
+#elif defined (TARGET_LPC17XX)
+	InterruptIn_GPIOINT_TypeDef* gpioInt = LPC_GPIOINT_PORT[portNum];
+	uint32_t rising = gpioInt->StatR;
+
+	status = rising | gpioInt->StatF;
+	gpioInt->Clr = status;
+
+	levels = rising;	// A rising edge leaves the pin high, a falling one low
+#endif
+
+	uint32_t limited = status & _rateLimitedPins[portNum];
+	if(limited){
+		status &= ~InterruptIn_countEvents(portNum, limited);
+	}
+
+	uint32_t queued = status & _queuedPins[portNum];
+	if(queued){
+		InterruptIn_recordEvents(portNum, queued, levels);
+		status &= ~queued;
+	}
+
+	while(status){
+		uint8_t bit = InterruptIn_highestBit(status);
+		status &= ~(1UL << bit);
+
+		PinName pin = (PinName)((portNum << 5) | bit);
+		uint8_t pinIndex = GET_PIN_INDEX(pin);
+		if(_userHandlerPtr[pinIndex] != NULL){
+			(_userHandlerPtr[pinIndex])();
+		}
+		ContextHandler_call(&_userContextHandler[pinIndex], pin, (levels >> bit) & 1);
+	}
+
+}
+
+/**
+ * Enables the timestamped edge event queue.
+ *
+ * Pins selected with InterruptIn_queueEvents no longer call their user handler
+ * from the interrupt. Instead the port handler stores the pin, its level and the
+ * count of a free-running microsecond timer in buffer, and the application reads
+ * them later with InterruptIn_getEvent or InterruptIn_processEvents. The timer is
+ * configured by this function; a 32 bit timer avoids 65 ms timestamp wraparound.
+ * On LPC17xx timerNum 0..3 selects TIM0..TIM3, all of them 32 bit.
+ *
+ * The port handlers may preempt each other and all of them write the ring, so they
+ * mask the interrupts for the few cycles they take to claim and publish the slots.
+ * The application is the only reader and never disables interrupts. The ring holds
+ * up to size - 1 events.
+ *
+ * @param timerNum Hardware timer used as timestamp source
+ * @param buffer user allocated ring storage
+ * @param size number of entries in buffer
+ *
+ * @see HardwareTimer_InitFreeRunning
+ */
+void InterruptIn_enableEventQueue(HardwareTimerNum timerNum, InterruptInEvent* buffer, uint16_t size){
+
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+	HardwareTimer_InitFreeRunning(timerNum);
+	_eventClock = &HardwareTimer_getLPC_TMR(timerNum)->TC;
+#elif defined (TARGET_LPC17XX)
+	/* No HardwareTimer driver yet, timerNum selects TIM0..TIM3 directly */
+	static LPC_TIM_TypeDef* const timers[4] = {LPC_TIM0, LPC_TIM1, LPC_TIM2, LPC_TIM3};
+	static const uint8_t powerBit[4] = {1, 2, 22, 23};
+	static const uint8_t pclkDivider[4] = {4, 1, 2, 8};
+	LPC_TIM_TypeDef* timer = timers[timerNum];
+	uint32_t pclkSel = (timerNum < 2) ? (LPC_SC->PCLKSEL0 >> (2 + (timerNum * 2)))
+	                                  : (LPC_SC->PCLKSEL1 >> (12 + ((timerNum - 2) * 2)));
+
+	BITBAND_SET_BIT(LPC_SC->PCONP, powerBit[timerNum]);
+	timer->TCR = 0x02;		/* reset timer */
+	timer->PR  = (SystemCoreClock / pclkDivider[pclkSel & 0x3] / 1000000) - 1;
+	timer->MCR = 0x00;
+	timer->TCR = 0x01;		/* start timer */
+	_eventClock = &timer->TC;
+#endif
+
+	_eventHead = 0;
+	_eventTail = 0;
+	_eventsLost = 0;
+	_eventBufferSize = size;
+	_eventBuffer = buffer;
+}
+
+/**
+ * Selects whether the edges of a pin go to the event queue or to its user handler.
+ *
+ * @param pin interrupt pin
+ * @param enable true to queue the pin's events
+ *
+ * @see InterruptIn_enableEventQueue
+ */
+void InterruptIn_queueEvents(PinName pin, bool enable){
+
+	uint32_t portNum = GET_PORT_NUM(pin);
+	uint32_t mask = GET_MASK_NUM(pin);
+
+	if(enable && _eventBuffer != NULL){
+		_queuedPins[portNum] |= mask;
+	}else{
+		_queuedPins[portNum] &= ~mask;
+	}
+}
+
+/**
+ * Removes the oldest event from the queue.
+ *
+ * @param event receives the event
+ * @return 1 if an event was read, 0 if the queue is empty
+ */
+uint8_t InterruptIn_getEvent(InterruptInEvent* event){
+
+	uint16_t tail = _eventTail;
+
+	if(tail == _eventHead){
+		return 0;
+	}
+
+	*event = _eventBuffer[tail];
+
+	tail++;
+	if(tail == _eventBufferSize){
+		tail = 0;
+	}
+	_eventTail = tail;	// Release the slot only after it was copied
+
+	return 1;
+}
+
+/**
+ * Calls handler for every queued event, oldest first.
+ *
+ * @param handler function receiving each event
+ * @return number of events processed
+ */
+uint16_t InterruptIn_processEvents(InterruptInEventHandler handler){
+
+	InterruptInEvent event;
+	uint16_t count = 0;
+
+	while(InterruptIn_getEvent(&event)){
+		handler(&event);
+		count++;
+	}
+
+	return count;
+}
+
+/**
+ * Returns how many events were dropped because the queue was full.
+ */
+uint32_t InterruptIn_getLostEvents(void){
+	return _eventsLost;
+}
+
+/******************************************************************************************
+ *
+ * 				Rate limiting
+ *
+ ******************************************************************************************/
+
+/**
+ * Limits the interrupts of pin to maxEvents per window, the window being the period at
+ * which InterruptIn_rateLimitTick is called (see InterruptIn_startRateLimiter). The event
+ * going over the limit is dropped and the pin interrupt is masked, then enabled again by
+ * the tick after one full window, discarding the edges seen while it was masked. This
+ * bounds the interrupt load of a bouncing or noisy line.
+ *
+ * @param pin interrupt pin
+ * @param maxEvents events accepted per window, 0 removes the limit
+ *
+ * @see InterruptIn_getLimitCount
+ */
+void InterruptIn_setRateLimit(PinName pin, uint8_t maxEvents){
+
+	uint32_t portNum = GET_PORT_NUM(pin);
+	uint32_t mask = GET_MASK_NUM(pin);
+	InterruptInRateLimit* limit;
+	uint32_t primask = __get_PRIMASK();
+
+	if(!IS_VALID_PIN(pin)){
+		return;
+	}
+
+	limit = &_rateLimit[GET_PIN_INDEX(pin)];
+	__disable_irq();
+	limit->maxEvents = maxEvents;
+	limit->events = 0;
+	if(maxEvents != 0){
+		_rateLimitedPins[portNum] |= mask;
+	}else{
+		_rateLimitedPins[portNum] &= ~mask;
+		if(limit->cooldown != 0){
+			limit->cooldown = 0;
+			InterruptIn_clear(pin);
+			InterruptIn_enable(pin);
+		}
+	}
+	__set_PRIMASK(primask);
+}
+
+/**
+ * Starts a new rate limit window: clears the event counts and enables again the pins
+ * whose cooldown ended. Must be called periodically.
+ */
+void InterruptIn_rateLimitTick(){
+
+	uint8_t portNum;
+
+	for(portNum = 0; portNum < InterruptIn_PORTS; portNum++){
+		uint32_t pins = _rateLimitedPins[portNum];
+
+		while(pins){
+			uint8_t bit = InterruptIn_highestBit(pins);
+			pins &= ~(1UL << bit);
+
+			PinName pin = (PinName)((portNum << 5) | bit);
+			InterruptInRateLimit* limit = &_rateLimit[GET_PIN_INDEX(pin)];
+
+			limit->events = 0;
+			if(limit->cooldown != 0 && --(limit->cooldown) == 0){
+				InterruptIn_clear(pin);	// Edges latched while masked are stale
+				InterruptIn_enable(pin);
+			}
+		}
+	}
+}
+
+/**
+ * Returns how many times the rate limiter masked the pin.
+ *
+ * @param pin interrupt pin
+ */
+uint16_t InterruptIn_getLimitCount(PinName pin){
+	if(!IS_VALID_PIN(pin)){
+		return 0;
+	}
+	return _rateLimit[GET_PIN_INDEX(pin)].limits;
+}
+
+/**
+ * Returns true while the rate limiter keeps the pin masked.
+ *
+ * @param pin interrupt pin
+ */
+bool InterruptIn_isThrottled(PinName pin){
+	if(!IS_VALID_PIN(pin)){
+		return false;
+	}
+	return (_rateLimit[GET_PIN_INDEX(pin)].cooldown != 0) ? true : false;
+}
+
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+/**
+ * Runs InterruptIn_rateLimitTick on every interrupt of a hardware timer.
+ * The timer user handler is replaced.
+ *
+ * @param timerNum Hardware timer dedicated to rate limiting.
+ * @param window_us Rate limit window in microseconds.
+ *
+ * @see HardwareTimerNum
+ */
+void InterruptIn_startRateLimiter(HardwareTimerNum timerNum, uint32_t window_us){
+	HardwareTimer_Init(timerNum, window_us);
+	HardwareTimer_setUserHandler(timerNum, InterruptIn_rateLimitTick);
+	HardwareTimer_enable(timerNum);
+}
+#endif
@@ -35,7 +35,7 @@ void PWM_init(HardwareTimerNum timerNum, uint32_t period, uint8_t match_enable,
 
 		/* Some of the I/O pins need to be clearfully planned if
 			    you use below module because JTAG and TIMER CAP/MAT pins are muxed. */
-		LPC_SYSCON->SYSAHBCLKCTRL |= (1<<9);
+		BITBAND_SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 9);
 
 		/* Setup the external match register */
 		LPC_TMR->EMR = (1<<EMC3)|(2<<EMC2)|(1<<EMC1)|(1<<EMC0)|(1<<3)|(match_enable);
@@ -87,7 +87,7 @@ void PWM_init(HardwareTimerNum timerNum, uint32_t period, uint8_t match_enable,
 
 		/* Some of the I/O pins need to be clearfully planned if
 			    you use below module because JTAG and TIMER CAP/MAT pins are muxed. */
-		LPC_SYSCON->SYSAHBCLKCTRL |= (1<<10);
+		BITBAND_SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 10);
 
 		/* Setup the external match register */
 		LPC_TMR->EMR = (1<<EMC3)|(1<<EMC2)|(2<<EMC1)|(1<<EMC0)|(1<<3)|(match_enable);
@@ -144,7 +144,7 @@ void PWM_init(HardwareTimerNum timerNum, uint32_t period, uint8_t match_enable,
 
 		/* Some of the I/O pins need to be clearfully planned if
 				you use below module because JTAG and TIMER CAP/MAT pins are muxed. */
-		LPC_SYSCON->SYSAHBCLKCTRL |= (1<<7);
+		BITBAND_SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 7);
 
 		/* Setup the external match register */
 		LPC_TMR->EMR = (1<<EMC3)|(1<<EMC2)|(1<<EMC1)|(1<<EMC0)|(1<<3)|(match_enable);
@@ -192,7 +192,7 @@ void PWM_init(HardwareTimerNum timerNum, uint32_t period, uint8_t match_enable,
 
 		/* Some of the I/O pins need to be clearfully planned if
 				you use below module because JTAG and TIMER CAP/MAT pins are muxed. */
-		LPC_SYSCON->SYSAHBCLKCTRL |= (1<<8);
+		BITBAND_SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 8);
 
 		/* Setup the external match register */
 		LPC_TMR->EMR = (1<<EMC3)|(1<<EMC2)|(1<<EMC1)|(2<<EMC0)|(1<<3)|(match_enable);
@@ -0,0 +1,322 @@
+/**************************************************************************//**
+ *
+ * @file     PortCapture.c
+ * @author	 David Alain <dnascimento@fitec.org.br>
+ * @brief    Logic analyzer: captures a GPIO port into RAM and exports it over Serial.
+ * @version  V1.0
+ *
+ ******************************************************************************/
+
+#include "peripherals/PortCapture.h"
+
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+extern LPC_GPIO_TypeDef (* const LPC_GPIO[4]);
+#elif defined (TARGET_LPC17XX)
+extern LPC_GPIO_TypeDef (* const LPC_GPIO[5]);
+#endif
+
+typedef struct {
+	volatile uint32_t* port;		/* DATA or FIOPIN of the captured port */
+	uint8_t shift;					/* Port pin stored in bit 0 of each sample */
+	uint16_t* buffer;				/* Ring of samples */
+	uint16_t size;
+	uint16_t preTrigger;
+	volatile uint16_t head;			/* Next position written */
+	volatile uint16_t remaining;	/* Samples still to store after the trigger */
+	uint32_t armedSamples;			/* Samples stored before the trigger */
+	uint16_t triggerIndex;			/* Position of the trigger sample */
+	uint16_t last;					/* Previous sample, for edge triggers */
+	PortCaptureTrigger trigger;
+	uint16_t mask;
+	uint16_t pattern;
+	volatile PortCaptureState state;
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+	HardwareTimerNum timerNum;		/* Timer stopped at the end of the capture */
+	bool timerRunning;
+#endif
+} PortCaptureObj;
+
+static PortCaptureObj _capture;
+
+/**
+ * Initializes the capture of a GPIO port.
+ * Each sample keeps 16 pins of the port, from firstPin up, packed in one uint16_t
+ * (firstPin = 0 captures the whole 12 pins port of the LPC13xx/LPC111X).
+ *
+ * @param portNum Port number (0, 1, 2, ...).
+ * @param firstPin Pin of the port stored in bit 0 of the samples.
+ * @param allocatedBuffer Buffer allocated by the user.
+ * @param bufferSize Number of samples of allocatedBuffer.
+ * @param preTrigger Samples kept before the trigger, the rest of the buffer is filled after it.
+ */
+void PortCapture_Init(uint8_t portNum, uint8_t firstPin, uint16_t* allocatedBuffer, uint16_t bufferSize, uint16_t preTrigger){
+
+	_capture.state = CAPTURE_IDLE;
+
+#if defined (TARGET_LPC13XX) || defined (TARGET_LPC111X)
+	_capture.port = &(LPC_GPIO[portNum]->DATA);
+#elif defined (TARGET_LPC17XX)
+	_capture.port = &(LPC_GPIO[portNum]->FIOPIN);
+#endif
+
+	if(preTrigger >= bufferSize){
+		preTrigger = bufferSize - 1;
+	}
+
+	_capture.shift = firstPin & 0x1F;
+	_capture.buffer = allocatedBuffer;
+	_capture.size = bufferSize;
+	_capture.preTrigger = preTrigger;
+	_capture.trigger = CAPTURE_TRIGGER_NONE;
+	_capture.mask = 0;
+	_capture.pattern = 0;
+}
+
+/**
+ * Sets the trigger condition, evaluated on every sample while the capture is armed.
+ *
+ * @param trigger Trigger type.
+ * @param mask Sample bits that take part in the trigger.
+ * @param pattern Value of the mask bits for CAPTURE_TRIGGER_PATTERN.
+ *
+ * @see PortCaptureTrigger
+ */
+void PortCapture_setTrigger(PortCaptureTrigger trigger, uint16_t mask, uint16_t pattern){
+	_capture.trigger = trigger;
+	_capture.mask = mask;
+	_capture.pattern = pattern & mask;
+}
+
+/**
+ * Starts a new capture: samples are stored continuously until the trigger,
+ * then the buffer is completed with the post-trigger samples.
+ */
+void PortCapture_arm(){
+	_capture.state = CAPTURE_IDLE;
+	_capture.head = 0;
+	_capture.armedSamples = 0;
+	_capture.remaining = _capture.size - _capture.preTrigger;
+	_capture.last = (uint16_t) (*_capture.port >> _capture.shift);
+	_capture.state = CAPTURE_ARMED;
+}
+
+/**
+ * Auxiliary function that stores one sample and runs the trigger.
+ *
+ * @return true when the capture is finished.
+ */
+static inline bool PortCapture_store(uint16_t sample){
+
+	bool fired = false;
+
+	if(_capture.state == CAPTURE_ARMED){
+
+		switch(_capture.trigger){
+		case CAPTURE_TRIGGER_NONE:		fired = true; break;
+		case CAPTURE_TRIGGER_PATTERN:	fired = ((sample & _capture.mask) == _capture.pattern); break;
+		case CAPTURE_TRIGGER_RISING:	fired = ((~_capture.last & sample & _capture.mask) != 0); break;
+		case CAPTURE_TRIGGER_FALLING:	fired = ((_capture.last & ~sample & _capture.mask) != 0); break;
+		case CAPTURE_TRIGGER_EDGE:		fired = (((_capture.last ^ sample) & _capture.mask) != 0); break;
+		}
+		_capture.last = sample;
+
+		if(fired){
+			_capture.triggerIndex = _capture.head;
+			_capture.state = CAPTURE_TRIGGERED;
+		}else{
+			_capture.armedSamples++;
+		}
+	}
+
+	_capture.buffer[_capture.head] = sample;
+	_capture.head = (_capture.head + 1 == _capture.size) ? 0 : _capture.head + 1;
+
+	if(_capture.state == CAPTURE_TRIGGERED && --_capture.remaining == 0){
+		_capture.state = CAPTURE_DONE;
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * Takes one sample of the port. Call it from a periodic interrupt, the sampling rate is the interrupt rate.
+ */
+void PortCapture_sample(){
+
+	if(_capture.state != CAPTURE_ARMED && _capture.state != CAPTURE_TRIGGERED){
+		return;
+	}
+
+	if(PortCapture_store((uint16_t) (*_capture.port >> _capture.shift))){
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+		if(_capture.timerRunning){
+			HardwareTimer_disable(_capture.timerNum);
+			_capture.timerRunning = false;
+		}
+#endif
+	}
+}
+
+/**
+ * Arms and runs the whole capture in a loop with the interrupts disabled, for the highest and steadiest sampling rate.
+ * The sampling period is fixed by the loop (a few tens of cycles) plus delayLoops iterations of an empty loop,
+ * it is best measured once with a known signal.
+ *
+ * @param delayLoops Extra delay between samples, 0 for the fastest capture.
+ * @param timeoutSamples Samples to wait for the trigger before giving up, 0 to wait forever.
+ * @return true if the trigger happened and the buffer is complete.
+ */
+bool PortCapture_captureLoop(uint32_t delayLoops, uint32_t timeoutSamples){
+
+	volatile uint32_t* port = _capture.port;
+	uint8_t shift = _capture.shift;
+	uint32_t primask = __get_PRIMASK();
+	volatile uint32_t delay;
+	bool done = false;
+
+	PortCapture_arm();
+
+	__disable_irq();
+
+	while(!done){
+		done = PortCapture_store((uint16_t) (*port >> shift));
+
+		if(timeoutSamples != 0 && _capture.state == CAPTURE_ARMED && _capture.armedSamples >= timeoutSamples){
+			_capture.state = CAPTURE_IDLE;
+			break;
+		}
+
+		for(delay = delayLoops ; delay != 0 ; delay--);
+	}
+
+	__set_PRIMASK(primask);
+
+	return done;
+}
+
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+/**
+ * Arms the capture and samples the port on every interrupt of a hardware timer.
+ * The timer user handler is replaced and the timer is stopped when the capture is finished.
+ *
+ * @param timerNum Hardware timer dedicated to the capture.
+ * @param interval_us Sampling period in microseconds.
+ *
+ * @see HardwareTimerNum
+ */
+void PortCapture_start(HardwareTimerNum timerNum, uint32_t interval_us){
+	PortCapture_arm();
+	_capture.timerNum = timerNum;
+	_capture.timerRunning = true;
+	HardwareTimer_Init(timerNum, interval_us);
+	HardwareTimer_setUserHandler(timerNum, PortCapture_sample);
+	HardwareTimer_enable(timerNum);
+}
+#endif
+
+/**
+ * Returns the state of the capture.
+ *
+ * @see PortCaptureState
+ */
+PortCaptureState PortCapture_getState(){
+	return _capture.state;
+}
+
+/**
+ * Copies a finished capture in chronological order.
+ *
+ * @param samples Destination buffer.
+ * @param maxSamples Size of samples.
+ * @return number of samples copied.
+ */
+uint16_t PortCapture_read(uint16_t* samples, uint16_t maxSamples){
+
+	uint16_t stored, index, i;
+
+	if(_capture.state != CAPTURE_DONE){
+		return 0;
+	}
+
+	stored = (_capture.armedSamples >= _capture.preTrigger) ? _capture.size : (_capture.size - _capture.preTrigger + _capture.armedSamples);
+	index = (stored == _capture.size) ? _capture.head : 0;
+
+	for(i = 0 ; i < stored && i < maxSamples ; i++){
+		samples[i] = _capture.buffer[index];
+		index = (index + 1 == _capture.size) ? 0 : index + 1;
+	}
+
+	return i;
+}
+
+/**
+ * Sends a finished capture over Serial in run-length format, all fields little endian:
+ *
+ *   uint16 PortCapture_EXPORT_MAGIC
+ *   uint8  first pin, uint8 reserved
+ *   uint16 number of samples, uint16 position of the trigger sample
+ *   runs:  uint16 value, uint16 length (1..65535), ... terminated by a run of length 0
+ *
+ * Signals that change rarely take a few bytes instead of two bytes per sample.
+ *
+ * @param portNum Serial port, already configured.
+ */
+void PortCapture_export(SerialPortNum portNum){
+
+	uint8_t out[32];
+	uint16_t n = 0;
+	uint16_t stored, index, triggerPos, i;
+	uint16_t value, length;
+
+	if(_capture.state != CAPTURE_DONE){
+		return;
+	}
+
+	stored = (_capture.armedSamples >= _capture.preTrigger) ? _capture.size : (_capture.size - _capture.preTrigger + _capture.armedSamples);
+	index = (stored == _capture.size) ? _capture.head : 0;
+	triggerPos = (_capture.triggerIndex >= index) ? (_capture.triggerIndex - index) : (_capture.triggerIndex + _capture.size - index);
+
+	out[n++] = PortCapture_EXPORT_MAGIC & 0xFF;
+	out[n++] = PortCapture_EXPORT_MAGIC >> 8;
+	out[n++] = _capture.shift;
+	out[n++] = 0;
+	out[n++] = stored & 0xFF;
+	out[n++] = stored >> 8;
+	out[n++] = triggerPos & 0xFF;
+	out[n++] = triggerPos >> 8;
+
+	value = _capture.buffer[index];
+	length = 0;
+
+	for(i = 0 ; i <= stored ; i++){
+
+		if(i < stored && _capture.buffer[index] == value && length != 0xFFFF){
+			length++;
+		}else{
+			out[n++] = value & 0xFF;
+			out[n++] = value >> 8;
+			out[n++] = length & 0xFF;
+			out[n++] = length >> 8;
+
+			if(n > sizeof(out) - 4){
+				Serial_write(portNum, out, n);
+				n = 0;
+			}
+
+			if(i < stored){
+				value = _capture.buffer[index];
+				length = 1;
+			}
+		}
+
+		index = (index + 1 == _capture.size) ? 0 : index + 1;
+	}
+
+	/* End of runs */
+	out[n++] = 0;
+	out[n++] = 0;
+	out[n++] = 0;
+	out[n++] = 0;
+	Serial_write(portNum, out, n);
+}
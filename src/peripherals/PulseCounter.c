@@ -0,0 +1,198 @@
+/**************************************************************************//**
+ *
+ * @file     PulseCounter.c
+ * @author	 David Alain <dnascimento@fitec.org.br>
+ * @brief    Counts pulses in hardware with the timers in counter mode and decodes quadrature encoders.
+ * @version  V1.0
+ *
+ ******************************************************************************/
+
+#include "peripherals/PulseCounter.h"
+#include "peripherals/InterruptIn.h"
+#include "peripherals/Digital.h"
+
+/* Needs HardwareTimer, not implemented for the LPC17XX, where this module is left out of the build */
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+
+#define TIMER_NUM 4
+
+extern volatile uint32_t* Digital_getIOConfigRegister(PinName pin);
+
+/* CAP0 input of each timer and the IOCON function that selects it */
+static const PinName _inputPin[TIMER_NUM] = {P0_2, P1_8, P1_5, P1_0};
+static const uint8_t _inputFunction[TIMER_NUM] = {0x2, 0x1, 0x2, 0x3};
+
+typedef struct {
+	HardwareTimerNum counterA;
+	HardwareTimerNum counterB;
+	uint32_t lastA;
+	uint32_t lastB;
+	int32_t position;
+	int8_t direction;			/* +1 or -1, from the level of the direction pin */
+} PulseCounterQuadratureObj;
+
+static PulseCounterQuadratureObj _quadrature;
+
+/**
+ * Returns the counter range mask, 16 bit timers wrap at 0xFFFF.
+ */
+static inline uint32_t PulseCounter_getMask(HardwareTimerNum timerNum){
+	return (timerNum == HARDWARE_TIMER_16_0 || timerNum == HARDWARE_TIMER_16_1) ? 0xFFFF : 0xFFFFFFFF;
+}
+
+/**
+ * Returns the CAP0 pin that drives the counter of a timer.
+ *
+ * @param timerNum Hardware timer
+ *
+ * @see HardwareTimerNum
+ */
+PinName PulseCounter_getInputPin(HardwareTimerNum timerNum){
+	return _inputPin[timerNum];
+}
+
+/**
+ * Puts a hardware timer in counter mode, so the timer counter is incremented by the
+ * edges of its CAP0 pin instead of the peripheral clock. No interrupt is generated:
+ * the count is read with PulseCounter_read at any time. Each level of the input must
+ * last at least two clock cycles, limiting the input to a quarter of the core clock.
+ * 16 bit timers wrap around every 65536 edges.
+ *
+ * Note: the timer can not be used by HardwareTimer_Init at the same time.
+ *
+ * @param timerNum Hardware timer
+ * @param edge edges of the input pin that are counted
+ *
+ * @see PulseCounter_getInputPin
+ */
+void PulseCounter_Init(HardwareTimerNum timerNum, PulseCounterEdge edge){
+
+	LPC_TMR_TypeDef* LPC_TMR = HardwareTimer_getLPC_TMR(timerNum);
+	volatile uint32_t* ioconReg = Digital_getIOConfigRegister(_inputPin[timerNum]);
+
+	BITBAND_SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, (timerNum + 7));
+
+	*ioconReg = (*ioconReg & ~0x7) | _inputFunction[timerNum];
+
+	LPC_TMR->TCR  = 0x02;		/* reset timer */
+	LPC_TMR->PR   = 0x00;		/* count every edge */
+	LPC_TMR->MCR  = 0x00;
+	LPC_TMR->CCR  = 0x00;		/* CAP0 can not capture while it clocks the counter */
+	LPC_TMR->CTCR = edge;		/* counter mode, input CAP0 */
+	LPC_TMR->IR   = 0xff;		/* reset all interrupts */
+	LPC_TMR->TCR  = 0x01;		/* start counting */
+}
+
+/**
+ * Returns the number of edges counted since PulseCounter_Init or PulseCounter_reset.
+ *
+ * @param timerNum Hardware timer
+ */
+uint32_t PulseCounter_read(HardwareTimerNum timerNum){
+	return HardwareTimer_getLPC_TMR(timerNum)->TC;
+}
+
+/**
+ * Restarts the count of a pulse counter from zero.
+ *
+ * @param timerNum Hardware timer
+ */
+void PulseCounter_reset(HardwareTimerNum timerNum){
+
+	LPC_TMR_TypeDef* LPC_TMR = HardwareTimer_getLPC_TMR(timerNum);
+
+	LPC_TMR->TCR = 0x03;
+	LPC_TMR->TCR = 0x01;
+}
+
+/**
+ * Adds the edges counted since the last call to the position, with the current direction.
+ * Must run with the direction pin interrupt masked or from it.
+ */
+static void PulseCounter_accumulate(){
+
+	uint32_t countA = PulseCounter_read(_quadrature.counterA);
+	uint32_t countB = PulseCounter_read(_quadrature.counterB);
+	uint32_t edges = ((countA - _quadrature.lastA) & PulseCounter_getMask(_quadrature.counterA))
+	               + ((countB - _quadrature.lastB) & PulseCounter_getMask(_quadrature.counterB));
+
+	_quadrature.lastA = countA;
+	_quadrature.lastB = countB;
+	_quadrature.position += (_quadrature.direction > 0) ? (int32_t)edges : -(int32_t)edges;
+}
+
+/**
+ * Direction pin handler: closes the count of the previous direction and takes the new one.
+ */
+static void PulseCounter_directionHandler(void* context, uint32_t source, uint32_t level){
+	PulseCounter_accumulate();
+	_quadrature.direction = level ? 1 : -1;
+}
+
+/**
+ * Decodes a quadrature encoder with two pulse counters and a direction signal.
+ *
+ * Channel A is wired to the input pin of counterA and channel B to the input pin of
+ * counterB, both counting every edge, which gives four counts per encoder cycle with
+ * no interrupt per pulse. directionPin carries the rotation direction, high when
+ * moving forward (encoder DIR output, or a D flip-flop clocked by A with B on its
+ * data input). Only direction changes interrupt the CPU, then the counts taken so
+ * far are added to the position with the previous direction.
+ *
+ * With 16 bit counters PulseCounter_readPosition must be called at least every 65536
+ * edges of each channel.
+ *
+ * @param counterA Hardware timer counting channel A
+ * @param counterB Hardware timer counting channel B
+ * @param directionPin Pin with interrupt giving the direction
+ *
+ * @see PulseCounter_getInputPin
+ */
+void PulseCounter_initQuadrature(HardwareTimerNum counterA, HardwareTimerNum counterB, PinName directionPin){
+
+	PulseCounter_Init(counterA, PULSE_COUNTER_BOTH_EDGES);
+	PulseCounter_Init(counterB, PULSE_COUNTER_BOTH_EDGES);
+
+	_quadrature.counterA = counterA;
+	_quadrature.counterB = counterB;
+	_quadrature.lastA = 0;
+	_quadrature.lastB = 0;
+	_quadrature.position = 0;
+	_quadrature.direction = Digital_readPort(GET_PORT_NUM(directionPin), GET_MASK_NUM(directionPin)) ? 1 : -1;
+
+	InterruptIn_Init(directionPin);
+	InterruptIn_configure(directionPin, EDGE, BOTH_EDGES, RISING_EDGE_OR_HIGH_LEVEL);
+	InterruptIn_setContextHandler(directionPin, PulseCounter_directionHandler, NULL);
+	InterruptIn_enable(directionPin);
+}
+
+/**
+ * Returns the encoder position in counts, positive forward.
+ */
+int32_t PulseCounter_readPosition(){
+
+	uint32_t primask = __get_PRIMASK();
+	int32_t position;
+
+	__disable_irq();
+	PulseCounter_accumulate();
+	position = _quadrature.position;
+	__set_PRIMASK(primask);
+
+	return position;
+}
+
+/**
+ * Sets the encoder position to zero.
+ */
+void PulseCounter_resetPosition(){
+
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	PulseCounter_accumulate();
+	_quadrature.position = 0;
+	__set_PRIMASK(primask);
+}
+
+#endif // TARGET_LPC111X or TARGET_LPC13XX
@@ -79,7 +79,7 @@ void Serial_configure(
 	LPC_IOCON->PIO1_7 |= 0x01;
 
 	/* Enable UART clock */
-	SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 12);
+	BITBAND_SET_BIT(LPC_SYSCON->SYSAHBCLKCTRL, 12);
 	LPC_SYSCON->UARTCLKDIV = 0x1;     /* divided by 1 */
 
 	LPC_UART->LCR = 0x80 | (wordLength | stopBits | enableParity | parityType);
@@ -21,30 +21,179 @@
 
 
 #include "peripherals/SoftwareTimer.h"
+#include "core/cmsis.h"
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+#include "peripherals/HardwareTimer.h"
+#endif
 
 #ifndef NUMBER_OF_SOFTWARE_TIMERS
 #define NUMBER_OF_SOFTWARE_TIMERS 4
 #endif
 
-typedef struct {
-	uint32_t counter;
+/* Slots of the hashed timing wheel, a power of two. Ticks cost O(timers / slots) amortized. */
+#ifndef SOFTWARE_TIMER_WHEEL_SIZE
+#define SOFTWARE_TIMER_WHEEL_SIZE 32
+#endif
+
+STATIC_ASSERT((SOFTWARE_TIMER_WHEEL_SIZE & (SOFTWARE_TIMER_WHEEL_SIZE - 1)) == 0, wheel_size_must_be_a_power_of_two);
+
+typedef struct SoftwateTimerObj {
 	uint32_t maxCounter;
+	uint32_t remaining;						// Time left when stopped, in microseconds
+	uint32_t expires;						// Tick of the next expiry, or its microsecond time when tickless
+	uint32_t late;							// Expiry tick minus the exact expiry time, in microseconds
 	SoftwareTimerState state;
 	FunctionPointer userHandler;
+	ContextHandler contextHandler;
+	struct SoftwateTimerObj* next;
+	struct SoftwateTimerObj** prevNext;		// Link pointing to this timer, NULL when not in a list
 } SoftwateTimerObj;
 
 static SoftwateTimerObj _timers[NUMBER_OF_SOFTWARE_TIMERS];
 
+static SoftwateTimerObj* _wheel[SOFTWARE_TIMER_WHEEL_SIZE];
+static SoftwateTimerObj* _pending;			// Started before the tick interval is known
+static uint32_t _now;						// Ticks elapsed
+static uint32_t _tick_us;					// Tick interval, 0 until the first tick
+
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+/* Tickless mode: running timers sorted by expiry time, MR0 holds the first one */
+static SoftwateTimerObj* _sorted;
+static LPC_TMR_TypeDef* _ticklessTimer = NULL;	// Free-running microsecond timer, NULL in tick mode
+static HardwareTimerNum _ticklessTimerNum;
+#endif
+
+static void SoftwareTimer_link(SoftwateTimerObj** list, SoftwateTimerObj* timer){
+	timer->next = *list;
+	timer->prevNext = list;
+	if(*list != NULL){
+		(*list)->prevNext = &timer->next;
+	}
+	*list = timer;
+}
+
+static void SoftwareTimer_unlink(SoftwateTimerObj* timer){
+	if(timer->prevNext == NULL){
+		return;
+	}
+	*(timer->prevNext) = timer->next;
+	if(timer->next != NULL){
+		timer->next->prevNext = timer->prevNext;
+	}
+	timer->prevNext = NULL;
+}
+
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+/**
+ * Inserts the timer in the sorted list, after the timers expiring at the same time.
+ * Expiries are compared by their signed difference, so the 32 bit counter may wrap around
+ * and a timer that is already due still sorts before the ones expiring later.
+ */
+static void SoftwareTimer_insertSorted(SoftwateTimerObj* timer){
+
+	SoftwateTimerObj** list = &_sorted;
+
+	while(*list != NULL && (int32_t)((*list)->expires - timer->expires) <= 0){
+		list = &((*list)->next);
+	}
+	SoftwareTimer_link(list, timer);
+}
+
+/**
+ * Programs MR0 with the first expiry, or stops the interrupts when no timer runs.
+ */
+static void SoftwareTimer_program(){
+
+	if(_sorted == NULL){
+		_ticklessTimer->MCR = 0x00;
+		return;
+	}
+
+	_ticklessTimer->MR0 = _sorted->expires;
+	_ticklessTimer->MCR = 0x01;		/* Interrupt on MR0, keep counting */
+
+	/* The expiry may pass before MR0 is written, then the match never happens */
+	if((int32_t)(_sorted->expires - _ticklessTimer->TC) <= 0){
+		NVIC_SetPendingIRQ(HardwareTimer_getIRQn(_ticklessTimerNum));
+	}
+}
+#endif
+
+/**
+ * Reprograms the next expiry after the running timers changed.
+ */
+static inline void SoftwareTimer_update(){
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+	if(_ticklessTimer != NULL){
+		SoftwareTimer_program();
+	}
+#endif
+}
+
+/**
+ * Puts the timer in the wheel slot of its expiry tick, the first tick at or after delay_us.
+ * In tickless mode the timer expires exactly delay_us from now.
+ */
+static void SoftwareTimer_schedule(SoftwateTimerObj* timer, uint32_t delay_us){
+
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+	if(_ticklessTimer != NULL){
+		timer->late = 0;
+		timer->expires = _ticklessTimer->TC + delay_us;
+		SoftwareTimer_insertSorted(timer);
+		return;
+	}
+#endif
+
+	if(_tick_us == 0){
+		timer->remaining = delay_us;
+		SoftwareTimer_link(&_pending, timer);
+		return;
+	}
+
+	uint32_t ticks = (delay_us + _tick_us - 1) / _tick_us;
+	if(ticks == 0){
+		ticks = 1;
+	}
+
+	timer->late = (ticks * _tick_us) - delay_us;
+	timer->expires = _now + ticks;
+	SoftwareTimer_link(&_wheel[timer->expires & (SOFTWARE_TIMER_WHEEL_SIZE - 1)], timer);
+}
+
 uint16_t SoftwareTimer_Init(uint16_t timerId, uint32_t timeInterval_us, FunctionPointer userHandler){
 
 	if(timerId >= NUMBER_OF_SOFTWARE_TIMERS){
 		return -1;
 	}
 
-	_timers[timerId].counter = 0;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	SoftwareTimer_unlink(&_timers[timerId]);
 	_timers[timerId].maxCounter = timeInterval_us;
+	_timers[timerId].remaining = timeInterval_us;
 	_timers[timerId].state = STATE_STOPED;
 	_timers[timerId].userHandler = userHandler;
+	_timers[timerId].contextHandler.function = NULL;
+
+	__set_PRIMASK(primask);
+
+	return 0;
+}
+
+/**
+ * Same as SoftwareTimer_Init, but the user function receives context, the timer id and
+ * how many microseconds late it was called, so one function can serve several timers.
+ */
+uint16_t SoftwareTimer_InitContext(uint16_t timerId, uint32_t timeInterval_us, ContextFunctionPointer userHandler, void* context){
+
+	if(SoftwareTimer_Init(timerId, timeInterval_us, NULL) != 0){
+		return -1;
+	}
+
+	_timers[timerId].contextHandler.context = context;
+	_timers[timerId].contextHandler.function = userHandler;
 
 	return 0;
 }
@@ -55,7 +204,17 @@ void SoftwareTimer_reset(uint16_t timerId)
 		return;
 	}
 
-	_timers[timerId].counter = 0;
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	_timers[timerId].remaining = _timers[timerId].maxCounter;
+	if(_timers[timerId].state == STATE_RUNNING){
+		SoftwareTimer_unlink(&_timers[timerId]);
+		SoftwareTimer_schedule(&_timers[timerId], _timers[timerId].maxCounter);
+		SoftwareTimer_update();
+	}
+
+	__set_PRIMASK(primask);
 }
 
 void SoftwareTimer_start(uint16_t timerId)
@@ -63,7 +222,17 @@ void SoftwareTimer_start(uint16_t timerId)
 	if(timerId >= NUMBER_OF_SOFTWARE_TIMERS){
 		return;
 	}
-	_timers[timerId].state = STATE_RUNNING;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	if(_timers[timerId].state != STATE_RUNNING){
+		_timers[timerId].state = STATE_RUNNING;
+		SoftwareTimer_schedule(&_timers[timerId], _timers[timerId].remaining);
+		SoftwareTimer_update();
+	}
+
+	__set_PRIMASK(primask);
 }
 
 void SoftwareTimer_stop(uint16_t timerId)
@@ -71,7 +240,30 @@ void SoftwareTimer_stop(uint16_t timerId)
 	if(timerId >= NUMBER_OF_SOFTWARE_TIMERS){
 		return;
 	}
-	_timers[timerId].state = STATE_STOPED;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	SoftwateTimerObj* timer = &_timers[timerId];
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+	if(_ticklessTimer != NULL){
+		if(timer->state == STATE_RUNNING){
+			int32_t left = (int32_t)(timer->expires - _ticklessTimer->TC);
+			timer->remaining = (left > 0) ? left : 1;
+		}
+	}else
+#endif
+	if(timer->state == STATE_RUNNING && timer->prevNext != NULL && _tick_us != 0){
+		/* Keep the time left, so start resumes the period where it stopped.
+		 * A timer already due in this tick has no time left and restarts a whole period. */
+		uint32_t left = (timer->expires - _now) * _tick_us;
+		timer->remaining = (left > timer->late) ? (left - timer->late) : timer->maxCounter;
+	}
+	SoftwareTimer_unlink(timer);
+	timer->state = STATE_STOPED;
+	SoftwareTimer_update();
+
+	__set_PRIMASK(primask);
 }
 
 SoftwareTimerState SoftwareTimer_getState(uint16_t timerId)
@@ -84,20 +276,129 @@ SoftwareTimerState SoftwareTimer_getState(uint16_t timerId)
 
 void SoftwareTimer_incrementTimers(uint32_t timeInterval_us)
 {
-	uint32_t timerId;
-	for(timerId = 0 ; timerId < NUMBER_OF_SOFTWARE_TIMERS ; timerId++){
+	SoftwateTimerObj* expired = NULL;
+	SoftwateTimerObj* timer;
 
-		if(_timers[timerId].state == STATE_RUNNING){
-			_timers[timerId].counter += timeInterval_us;
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+	if(_ticklessTimer != NULL){
+		return;
+	}
+#endif
+
+	/* Timers started before the first tick count from the previous tick */
+	_tick_us = timeInterval_us;
+	while((timer = _pending) != NULL){
+		SoftwareTimer_unlink(timer);
+		SoftwareTimer_schedule(timer, timer->remaining);
+	}
+
+	_now++;
+
+	/* Move the due timers out of the slot first, the handlers may start and stop timers */
+	timer = _wheel[_now & (SOFTWARE_TIMER_WHEEL_SIZE - 1)];
+	while(timer != NULL){
+		SoftwateTimerObj* next = timer->next;
+		if(timer->expires == _now){
+			SoftwareTimer_unlink(timer);
+			SoftwareTimer_link(&expired, timer);
+		}
+		timer = next;
+	}
+
+	while((timer = expired) != NULL){
+		uint32_t late = timer->late;
+
+		/* Periodic: the next period is shortened by the lateness, as the old counter did */
+		SoftwareTimer_unlink(timer);
+		SoftwareTimer_schedule(timer, (late < timer->maxCounter) ? (timer->maxCounter - late) : 0);
+
+		if(timer->userHandler != NULL){
+			timer->userHandler();
+		}
+		ContextHandler_call(&timer->contextHandler, timer - _timers, late);
+	}
+
+}
 
-			if(_timers[timerId].counter >= _timers[timerId].maxCounter){
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+/**
+ * Tickless mode interrupt: runs the handlers of every timer whose expiry time has come,
+ * in expiry order, then programs MR0 with the next expiry.
+ */
+static void SoftwareTimer_expireTickless(){
+
+	SoftwateTimerObj* expired = NULL;
+	SoftwateTimerObj** last = &expired;
+	SoftwateTimerObj* timer;
+	uint32_t now = _ticklessTimer->TC;
+
+	while((timer = _sorted) != NULL && (int32_t)(timer->expires - now) <= 0){
+		SoftwareTimer_unlink(timer);
+		timer->late = now - timer->expires;
+		SoftwareTimer_link(last, timer);
+		last = &(timer->next);
+	}
 
-				_timers[timerId].counter -= _timers[timerId].maxCounter;
-				_timers[timerId].userHandler();
-			}
+	while((timer = expired) != NULL){
+		uint32_t late = timer->late;
 
+		/* Periodic without drift: the next expiry counts from the previous one, unless it was missed */
+		SoftwareTimer_unlink(timer);
+		timer->expires += timer->maxCounter;
+		if((int32_t)(timer->expires - now) <= 0){
+			timer->expires = now + timer->maxCounter;
 		}
+		SoftwareTimer_insertSorted(timer);
 
+		if(timer->userHandler != NULL){
+			timer->userHandler();
+		}
+		ContextHandler_call(&timer->contextHandler, timer - _timers, late);
 	}
 
+	SoftwareTimer_program();
 }
+
+/**
+ * Switches the software timers to tickless mode.
+ *
+ * Instead of a periodic interrupt every timer interval, timerNum counts microseconds
+ * freely and its MR0 is programmed with the first expiry only, so the CPU wakes up
+ * once per expiry (never when no timer runs) and timeouts have microsecond
+ * resolution. Running timers are kept in a list sorted by expiry time.
+ *
+ * timerNum must be a 32 bit timer, it is reconfigured and its user handler replaced.
+ * Timeouts must be shorter than 2^31 microseconds (35 minutes). Timers already
+ * running restart their full period.
+ *
+ * @param timerNum HARDWARE_TIMER_32_0 or HARDWARE_TIMER_32_1
+ */
+void SoftwareTimer_startTickless(HardwareTimerNum timerNum){
+
+	uint16_t timerId;
+
+	if(timerNum != HARDWARE_TIMER_32_0 && timerNum != HARDWARE_TIMER_32_1){
+		return;
+	}
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	HardwareTimer_InitFreeRunning(timerNum);
+	HardwareTimer_setUserHandler(timerNum, SoftwareTimer_expireTickless);
+	_ticklessTimerNum = timerNum;
+	_ticklessTimer = HardwareTimer_getLPC_TMR(timerNum);
+
+	for(timerId = 0 ; timerId < NUMBER_OF_SOFTWARE_TIMERS ; timerId++){
+		SoftwareTimer_unlink(&_timers[timerId]);
+		if(_timers[timerId].state == STATE_RUNNING){
+			SoftwareTimer_schedule(&_timers[timerId], _timers[timerId].maxCounter);
+		}
+	}
+	SoftwareTimer_program();
+
+	NVIC_EnableIRQ(HardwareTimer_getIRQn(timerNum));
+
+	__set_PRIMASK(primask);
+}
+#endif
@@ -0,0 +1,130 @@
+/**************************************************************************//**
+ *
+ * @file     Timebase.c
+ * @author	 David Alain <dnascimento@fitec.org.br>
+ * @brief    Monotonic 64 bit microsecond time base on a free-running 32 bit timer.
+ * @version  V1.0
+ *
+ ******************************************************************************/
+
+#include "peripherals/Timebase.h"
+
+/* Needs HardwareTimer, not implemented for the LPC17XX, where this module is left out of the build */
+#if defined (TARGET_LPC111X) || defined (TARGET_LPC13XX)
+
+static LPC_TMR_TypeDef* _timebaseTimer = NULL;
+static volatile uint32_t _halfPeriods;		// Times the counter crossed 0x80000000 or wrapped to 0
+
+/**
+ * Match interrupt, twice per counter period: counts the half period and moves MR0 to the next one.
+ */
+static void Timebase_handler(){
+	_halfPeriods++;
+	_timebaseTimer->MR0 ^= 0x80000000;
+}
+
+/**
+ * Starts the time base on a dedicated 32 bit timer counting microseconds from zero.
+ *
+ * The timer counter gives the low 32 bits. The high 32 bits come from the count of
+ * half periods kept by a match interrupt every 35 minutes. A read takes one load of
+ * each and no lock: the most significant bit of the counter tells whether the half
+ * period count is behind, because the last crossing was not serviced yet, so reads
+ * stay monotonic while interrupts are masked for up to half a period.
+ *
+ * The timer user handler is replaced.
+ *
+ * @param timerNum HARDWARE_TIMER_32_0 or HARDWARE_TIMER_32_1
+ */
+void Timebase_Init(HardwareTimerNum timerNum){
+
+	if(timerNum != HARDWARE_TIMER_32_0 && timerNum != HARDWARE_TIMER_32_1){
+		return;
+	}
+
+	LPC_TMR_TypeDef* LPC_TMR = HardwareTimer_getLPC_TMR(timerNum);
+
+	HardwareTimer_InitFreeRunning(timerNum);
+	HardwareTimer_setUserHandler(timerNum, Timebase_handler);
+
+	LPC_TMR->TCR = 0x02;			/* reset timer */
+	_halfPeriods = 0;
+	_timebaseTimer = LPC_TMR;
+	LPC_TMR->MR0 = 0x80000000;		/* first half period */
+	LPC_TMR->MCR = 0x01;			/* Interrupt on MR0, keep counting */
+	LPC_TMR->IR  = 0xff;			/* reset all interrupts */
+	LPC_TMR->TCR = 0x01;			/* start timer */
+
+	NVIC_EnableIRQ(HardwareTimer_getIRQn(timerNum));
+}
+
+/**
+ * Returns the microseconds elapsed since Timebase_Init, never wrapping.
+ */
+uint64_t Timebase_read(){
+
+	uint32_t halfPeriods = _halfPeriods;
+	uint32_t low = _timebaseTimer->TC;
+
+	/* Upper half of the counter: the count is even before the midpoint interrupt, odd after it.
+	   Lower half: odd before the wrap interrupt, even after it. Both round to the same period. */
+	uint32_t high = (halfPeriods + 1 - (low >> 31)) >> 1;
+
+	return ((uint64_t)high << 32) | low;
+}
+
+/**
+ * Returns the low 32 bits of the time base, the cheapest timestamp. Wraps every 71 minutes,
+ * use Timebase_elapsed32 to compare them.
+ */
+uint32_t Timebase_read32(){
+	return _timebaseTimer->TC;
+}
+
+/**
+ * Returns the milliseconds elapsed since Timebase_Init.
+ */
+uint64_t Timebase_millis(){
+	return Timebase_toMillis(Timebase_read());
+}
+
+/**
+ * Returns the microseconds elapsed since a Timebase_read32 timestamp, correct across one wrap.
+ *
+ * @param since earlier Timebase_read32 value
+ */
+uint32_t Timebase_elapsed32(uint32_t since){
+	return _timebaseTimer->TC - since;
+}
+
+/**
+ * Returns true when at least duration_us elapsed since a Timebase_read32 timestamp.
+ *
+ * @param since earlier Timebase_read32 value
+ * @param duration_us timeout shorter than 71 minutes
+ */
+bool Timebase_expired32(uint32_t since, uint32_t duration_us){
+	return ((_timebaseTimer->TC - since) >= duration_us) ? true : false;
+}
+
+/**
+ * Converts microseconds to milliseconds. Times below 71 minutes use a 32 bit division.
+ */
+uint64_t Timebase_toMillis(uint64_t time_us){
+	if((time_us >> 32) == 0){
+		return (uint32_t)time_us / 1000;
+	}
+	return time_us / 1000;
+}
+
+/**
+ * Converts microseconds to seconds.
+ */
+uint32_t Timebase_toSeconds(uint64_t time_us){
+	if((time_us >> 32) == 0){
+		return (uint32_t)time_us / 1000000;
+	}
+	return (uint32_t)(time_us / 1000000);
+}
+
+#endif // TARGET_LPC111X or TARGET_LPC13XX